@@ -0,0 +1,123 @@
+#include "AlphaFilters.h"
+
+#include <vector>
+
+namespace {
+
+// value * alpha / 255 rounded to the nearest, without a division
+uint8_t multiplyAlpha(const uint32_t value, const uint32_t alpha)
+{
+	const uint32_t product = value * alpha + 128;
+	return static_cast<uint8_t>((product + (product >> 8)) >> 8);
+}
+
+}
+
+bool parseAlphaMode(const std::string_view text, AlphaMode& mode)
+{
+	if (text == "straight") mode = AlphaMode::Straight;
+	else if (text == "bleed") mode = AlphaMode::Bleed;
+	else if (text == "premultiply") mode = AlphaMode::Premultiply;
+	else return false;
+	return true;
+}
+
+void premultiplyAlpha(PixelBuffer& page, const rbp::Rect& rect)
+{
+	const size_t count = static_cast<size_t>(rect.width) * 4;
+
+	// Plain loops over bytes, which the compiler vectorizes
+	for (int y = rect.y; y < rect.y + rect.height; y++) {
+		uint8_t* pixel = page.row(static_cast<uint32_t>(y)) + static_cast<size_t>(rect.x) * 4;
+		for (size_t i = 0; i < count; i += 4) {
+			const uint32_t alpha = pixel[i + 3];
+			pixel[i]     = multiplyAlpha(pixel[i], alpha);
+			pixel[i + 1] = multiplyAlpha(pixel[i + 1], alpha);
+			pixel[i + 2] = multiplyAlpha(pixel[i + 2], alpha);
+		}
+	}
+}
+
+void bleedColors(PixelBuffer& page, const rbp::Rect& rect)
+{
+	const int width  = rect.width;
+	const int height = rect.height;
+	if (width <= 0 || height <= 0) return;
+
+	auto pixelAt = [&](const int x, const int y) {
+		return page.row(static_cast<uint32_t>(rect.y + y)) + static_cast<size_t>(rect.x + x) * 4;
+	};
+
+	// 1 for the pixels that have a color, 2 for the pixels queued in the next ring
+	std::vector<uint8_t> state(static_cast<size_t>(width) * height, 0);
+	std::vector<int>     ring;
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			if (pixelAt(x, y)[3] != 0) state[static_cast<size_t>(y) * width + x] = 1;
+		}
+	}
+
+	// The first ring is every transparent pixel next to an opaque one
+	auto queueNeighbours = [&](const int x, const int y) {
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				const int nx = x + dx;
+				const int ny = y + dy;
+				if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+
+				uint8_t& neighbour = state[static_cast<size_t>(ny) * width + nx];
+				if (neighbour != 0) continue;
+				neighbour = 2;
+				ring.push_back(ny * width + nx);
+			}
+		}
+	};
+	for (int index = 0; index < width * height; index++) {
+		if (state[static_cast<size_t>(index)] == 1) queueNeighbours(index % width, index / width);
+	}
+
+	std::vector<int>     next;
+	std::vector<uint8_t> colors;
+	while (!ring.empty()) {
+		// Average the neighbours colored before this ring, then color the whole ring at once so the order does not matter
+		colors.resize(ring.size() * 3);
+		for (size_t i = 0; i < ring.size(); i++) {
+			const int x = ring[i] % width;
+			const int y = ring[i] / width;
+
+			uint32_t sum[3] = {0, 0, 0};
+			uint32_t count  = 0;
+			for (int dy = -1; dy <= 1; dy++) {
+				for (int dx = -1; dx <= 1; dx++) {
+					const int nx = x + dx;
+					const int ny = y + dy;
+					if (nx < 0 || ny < 0 || nx >= width || ny >= height || state[static_cast<size_t>(ny) * width + nx] != 1) continue;
+
+					const uint8_t* color = pixelAt(nx, ny);
+					sum[0] += color[0];
+					sum[1] += color[1];
+					sum[2] += color[2];
+					count++;
+				}
+			}
+			for (int c = 0; c < 3; c++) colors[i * 3 + c] = static_cast<uint8_t>((sum[c] + count / 2) / count);
+		}
+
+		next.clear();
+		std::swap(ring, next);
+		for (size_t i = 0; i < next.size(); i++) {
+			uint8_t* pixel = pixelAt(next[i] % width, next[i] / width);
+			pixel[0] = colors[i * 3];
+			pixel[1] = colors[i * 3 + 1];
+			pixel[2] = colors[i * 3 + 2];
+			state[static_cast<size_t>(next[i])] = 1;
+		}
+		for (const int index : next) queueNeighbours(index % width, index / width);
+	}
+}
+
+void applyAlphaMode(PixelBuffer& page, const rbp::Rect& rect, const AlphaMode mode)
+{
+	if (mode == AlphaMode::Bleed) bleedColors(page, rect);
+	else if (mode == AlphaMode::Premultiply) premultiplyAlpha(page, rect);
+}
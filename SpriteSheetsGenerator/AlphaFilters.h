@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string_view>
+#include "PixelPool.h"
+#include "Rect.h"
+
+// What happens to the color of the transparent pixels of the sprites
+enum class AlphaMode {
+	Straight,		// kept as decoded
+	Bleed,			// replaced by the color of the nearest opaque pixels, for renderers that filter straight alpha
+	Premultiply		// every color multiplied by its alpha, transparent pixels become black which filters without halos
+};
+
+/* Parse "straight", "bleed" or "premultiply", return false for anything else. */
+bool parseAlphaMode(std::string_view text, AlphaMode& mode);
+
+/* Multiply the color of every pixel of 'rect' by its alpha, rounded to the nearest like the GPUs do. */
+void premultiplyAlpha(PixelBuffer& page, const rbp::Rect& rect);
+
+/*
+   Give every fully transparent pixel of 'rect' the average color of its neighbours that are opaque or already bled, one ring
+   of pixels at a time until the rectangle is full, so that filtering next to an edge does not pull in black. Alpha is untouched.
+*/
+void bleedColors(PixelBuffer& page, const rbp::Rect& rect);
+
+/* Apply the alpha mode to the sprite in 'rect'. */
+void applyAlphaMode(PixelBuffer& page, const rbp::Rect& rect, AlphaMode mode);
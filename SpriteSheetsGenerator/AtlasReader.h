@@ -0,0 +1,270 @@
+#pragma once
+
+/*
+	Binary sprite sheet format written next to the xml file, and a reader that maps the file in memory.
+	This header does not depend on the rest of the generator so it can be copied into the game.
+
+	Layout of the file, every integer is little-endian and every section is 4 bytes aligned:
+		AtlasHeader
+		AtlasRecord  records[spriteCount]		in the order of the xml file
+		uint32_t     displacements[bucketCount]	perfect hash, one seed per bucket
+		uint32_t     slots[spriteCount]			perfect hash, record index of every slot
+		char         strings[stringsSize]		names, not null terminated
+
+	A name is looked up with two hashes: the first one picks a bucket, the second one is seeded by the displacement of the bucket and picks a slot.
+	The displacements are chosen when writing so that no two names share a slot, a lookup is then one string compare.
+
+	Usage:
+		AtlasReader atlas;
+		if (atlas.open("sheets/sheet.atlas")) {
+			if (const AtlasRecord* sprite = atlas.find("BowWow")) draw(sprite->page, sprite->x, sprite->y, ...);
+		}
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+constexpr char     ATLAS_MAGIC[4] = {'S', 'S', 'G', 'A'};
+constexpr uint32_t ATLAS_VERSION  = 1;
+
+struct AtlasHeader {
+	char     magic[4];
+	uint32_t version;
+	uint32_t spriteCount;
+	uint32_t pageCount;
+	uint32_t bucketCount;
+	uint32_t recordsOffset;
+	uint32_t displacementsOffset;
+	uint32_t slotsOffset;
+	uint32_t stringsOffset;
+	uint32_t stringsSize;
+	uint32_t fileSize;
+	uint32_t reserved;
+};
+
+struct AtlasRecord {
+	uint32_t nameOffset;		// offset of the name in the string table
+	uint32_t nameLength;
+	uint16_t page;
+	uint16_t rotation;			// 0 or 90 degrees
+	uint16_t x;
+	uint16_t y;
+	uint16_t width;				// size in the sheet, swapped when rotated
+	uint16_t height;
+	uint16_t trimX;				// offset of the packed pixels in the source image
+	uint16_t trimY;
+	uint16_t sourceWidth;		// size of the source image before trimming
+	uint16_t sourceHeight;
+	uint16_t channel;			// 0 for whole pixels, 1 to 4 for a mask in the red to alpha channel of the page
+	uint16_t reserved;			// 0
+};
+
+static_assert(sizeof(AtlasHeader) == 48, "AtlasHeader must not have padding");
+static_assert(sizeof(AtlasRecord) == 32, "AtlasRecord must not have padding");
+
+/* FNV-1a hash of a name, shared by the writer and the reader. */
+constexpr uint64_t atlasHashName(const std::string_view name)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (const char c : name) {
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+/* Finalizer of splitmix64, spreads the bits of the name hash for the bucket and slot indices. */
+constexpr uint64_t atlasMix(uint64_t value)
+{
+	value ^= value >> 30;
+	value *= 0xbf58476d1ce4e5b9ull;
+	value ^= value >> 27;
+	value *= 0x94d049bb133111ebull;
+	value ^= value >> 31;
+	return value;
+}
+
+constexpr uint32_t atlasBucket(const uint64_t hash, const uint32_t bucketCount)
+{
+	return static_cast<uint32_t>(atlasMix(hash) % bucketCount);
+}
+
+constexpr uint32_t atlasSlot(const uint64_t hash, const uint32_t displacement, const uint32_t slotCount)
+{
+	return static_cast<uint32_t>(atlasMix(hash ^ (static_cast<uint64_t>(displacement) * 0x9e3779b97f4a7c15ull)) % slotCount);
+}
+
+// Read-only view of a binary sprite sheet mapped in memory, lookups do not allocate
+class AtlasReader {
+public:
+	AtlasReader() = default;
+	AtlasReader(const AtlasReader&) = delete;
+	AtlasReader& operator=(const AtlasReader&) = delete;
+
+	~AtlasReader()
+	{
+		close();
+	}
+
+	/* Map the file and check the header, return false if the file is missing or not a valid atlas. */
+	bool open(const char* path)
+	{
+		close();
+#ifdef _WIN32
+		m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) {
+			close();
+			return false;
+		}
+		m_size    = static_cast<size_t>(size.QuadPart);
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_mapping == nullptr) {
+			close();
+			return false;
+		}
+		m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+		const int fd = ::open(path, O_RDONLY);
+		if (fd < 0) return false;
+
+		struct stat st{};
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			::close(fd);
+			return false;
+		}
+		m_size = static_cast<size_t>(st.st_size);
+		void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		m_data = data == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(data);
+#endif
+		if (m_data == nullptr || !validate()) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close()
+	{
+#ifdef _WIN32
+		if (m_data) UnmapViewOfFile(m_data);
+		if (m_mapping) CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+		m_mapping = nullptr;
+		m_file    = INVALID_HANDLE_VALUE;
+#else
+		if (m_data) munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+		m_data   = nullptr;
+		m_size   = 0;
+		m_header = nullptr;
+	}
+
+	bool isOpen() const
+	{
+		return m_header != nullptr;
+	}
+
+	uint32_t size() const
+	{
+		return m_header ? m_header->spriteCount : 0;
+	}
+
+	uint32_t pageCount() const
+	{
+		return m_header ? m_header->pageCount : 0;
+	}
+
+	const AtlasRecord& operator[](const uint32_t index) const
+	{
+		return records()[index];
+	}
+
+	std::string_view name(const AtlasRecord& record) const
+	{
+		return {reinterpret_cast<const char*>(m_data + m_header->stringsOffset + record.nameOffset), record.nameLength};
+	}
+
+	/* The record with the given name or nullptr. */
+	const AtlasRecord* find(const std::string_view spriteName) const
+	{
+		if (!m_header || m_header->spriteCount == 0) return nullptr;
+
+		const uint64_t     hash         = atlasHashName(spriteName);
+		const uint32_t     displacement = displacements()[atlasBucket(hash, m_header->bucketCount)];
+		const uint32_t     index        = slots()[atlasSlot(hash, displacement, m_header->spriteCount)];
+		const AtlasRecord& record       = records()[index];
+		return name(record) == spriteName ? &record : nullptr;
+	}
+
+private:
+	const AtlasRecord* records() const
+	{
+		return reinterpret_cast<const AtlasRecord*>(m_data + m_header->recordsOffset);
+	}
+
+	const uint32_t* displacements() const
+	{
+		return reinterpret_cast<const uint32_t*>(m_data + m_header->displacementsOffset);
+	}
+
+	const uint32_t* slots() const
+	{
+		return reinterpret_cast<const uint32_t*>(m_data + m_header->slotsOffset);
+	}
+
+	/* Check the header and that every section and name is inside the file, so that lookups never read out of bounds. */
+	bool validate()
+	{
+		if (m_size < sizeof(AtlasHeader)) return false;
+		const auto* header = reinterpret_cast<const AtlasHeader*>(m_data);
+
+		if (std::memcmp(header->magic, ATLAS_MAGIC, sizeof(ATLAS_MAGIC)) != 0 || header->version != ATLAS_VERSION) return false;
+		if (header->fileSize != m_size) return false;
+
+		const uint64_t count = header->spriteCount;
+		if (count > 0 && header->bucketCount == 0) return false;
+		if (static_cast<uint64_t>(header->recordsOffset) + count * sizeof(AtlasRecord) > m_size) return false;
+		if (static_cast<uint64_t>(header->displacementsOffset) + header->bucketCount * 4ull > m_size) return false;
+		if (static_cast<uint64_t>(header->slotsOffset) + count * 4ull > m_size) return false;
+		if (static_cast<uint64_t>(header->stringsOffset) + header->stringsSize > m_size) return false;
+		if ((header->recordsOffset | header->displacementsOffset | header->slotsOffset) % 4 != 0) return false;
+
+		m_header = header;
+		for (uint32_t i = 0; i < header->spriteCount; i++) {
+			const AtlasRecord& record = records()[i];
+			if (static_cast<uint64_t>(record.nameOffset) + record.nameLength > header->stringsSize || slots()[i] >= count) {
+				m_header = nullptr;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	const uint8_t*     m_data   = nullptr;
+	size_t             m_size   = 0;
+	const AtlasHeader* m_header = nullptr;
+#ifdef _WIN32
+	HANDLE m_file    = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = nullptr;
+#endif
+};
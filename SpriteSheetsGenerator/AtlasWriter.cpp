@@ -0,0 +1,170 @@
+#include "AtlasWriter.h"
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include "AtlasReader.h"
+#include "AtomicFile.h"
+
+namespace {
+
+// Largest displacement tried for a bucket before retrying with more buckets
+constexpr uint32_t MAX_DISPLACEMENT = 1u << 20;
+
+/*
+   Find one displacement per bucket so that every name lands in its own slot, buckets with the most names are placed first.
+   Return false if a bucket cannot be placed, the caller then retries with more buckets.
+*/
+bool buildPerfectHash(const std::vector<uint64_t>& hashes, const uint32_t bucketCount, std::vector<uint32_t>& displacements, std::vector<uint32_t>& slots)
+{
+	const auto count = static_cast<uint32_t>(hashes.size());
+
+	std::vector<std::vector<uint32_t>> buckets(bucketCount);
+	for (uint32_t i = 0; i < count; i++) buckets[atlasBucket(hashes[i], bucketCount)].push_back(i);
+
+	std::vector<uint32_t> bucketOrder(bucketCount);
+	std::iota(bucketOrder.begin(), bucketOrder.end(), 0u);
+	std::stable_sort(bucketOrder.begin(), bucketOrder.end(), [&buckets](const uint32_t a, const uint32_t b) {
+		return buckets[a].size() > buckets[b].size();
+	});
+
+	displacements.assign(bucketCount, 0);
+	slots.assign(count, 0);
+	std::vector<char>     taken(count, 0);
+	std::vector<uint32_t> candidate;
+
+	for (const uint32_t bucket : bucketOrder) {
+		const std::vector<uint32_t>& keys = buckets[bucket];
+		if (keys.empty()) break;
+
+		bool placed = false;
+		for (uint32_t displacement = 0; displacement < MAX_DISPLACEMENT && !placed; displacement++) {
+			candidate.clear();
+			placed = true;
+			for (const uint32_t key : keys) {
+				const uint32_t slot = atlasSlot(hashes[key], displacement, count);
+				if (taken[slot] || std::find(candidate.begin(), candidate.end(), slot) != candidate.end()) {
+					placed = false;
+					break;
+				}
+				candidate.push_back(slot);
+			}
+
+			if (placed) {
+				displacements[bucket] = displacement;
+				for (size_t i = 0; i < keys.size(); i++) {
+					taken[candidate[i]] = 1;
+					slots[candidate[i]] = keys[i];
+				}
+			}
+		}
+		if (!placed) return false;
+	}
+	return true;
+}
+
+void putU16(std::vector<uint8_t>& out, const size_t offset, const uint32_t value)
+{
+	out[offset]     = static_cast<uint8_t>(value);
+	out[offset + 1] = static_cast<uint8_t>(value >> 8);
+}
+
+void putU32(std::vector<uint8_t>& out, const size_t offset, const uint32_t value)
+{
+	putU16(out, offset, value & 0xffff);
+	putU16(out, offset + 2, value >> 16);
+}
+
+size_t align4(const size_t value)
+{
+	return (value + 3) & ~static_cast<size_t>(3);
+}
+
+}
+
+bool writeAtlasBinary(const std::string& path, const SpriteCatalog& sprites, std::ostream& log)
+{
+	const uint32_t count = sprites.size();
+
+	// String table and name hashes
+	std::string           strings;
+	std::vector<uint32_t> nameOffsets(count);
+	std::vector<uint64_t> hashes(count);
+	for (uint32_t i = 0; i < count; i++) {
+		const std::string_view name = sprites.getName(i);
+		nameOffsets[i] = static_cast<uint32_t>(strings.size());
+		hashes[i]      = atlasHashName(name);
+		strings += name;
+	}
+
+	// The perfect hash only exists if every name is different
+	std::vector<uint32_t> byName(count);
+	std::iota(byName.begin(), byName.end(), 0u);
+	std::sort(byName.begin(), byName.end(), [&sprites](const uint32_t a, const uint32_t b) {
+		return sprites.getName(a) < sprites.getName(b);
+	});
+	for (size_t i = 1; i < byName.size(); i++) {
+		if (sprites.getName(byName[i - 1]) == sprites.getName(byName[i])) {
+			log << "Error: two images are named " << sprites.getName(byName[i]) << "\n";
+			return false;
+		}
+	}
+
+	// About four names per bucket, more buckets if a bucket cannot be placed
+	std::vector<uint32_t> displacements;
+	std::vector<uint32_t> slots;
+	uint32_t              bucketCount = std::max(1u, count / 4);
+	while (count > 0 && !buildPerfectHash(hashes, bucketCount, displacements, slots)) bucketCount *= 2;
+
+	// Sections
+	const size_t recordsOffset       = sizeof(AtlasHeader);
+	const size_t displacementsOffset = recordsOffset + count * sizeof(AtlasRecord);
+	const size_t slotsOffset         = displacementsOffset + displacements.size() * 4;
+	const size_t stringsOffset       = slotsOffset + slots.size() * 4;
+	const size_t fileSize            = align4(stringsOffset + strings.size());
+
+	std::vector<uint8_t> out(fileSize, 0);
+	std::copy(std::begin(ATLAS_MAGIC), std::end(ATLAS_MAGIC), out.begin());
+	putU32(out, 4, ATLAS_VERSION);
+	putU32(out, 8, count);
+	putU32(out, 12, sprites.pageCount());
+	putU32(out, 16, static_cast<uint32_t>(displacements.size()));
+	putU32(out, 20, static_cast<uint32_t>(recordsOffset));
+	putU32(out, 24, static_cast<uint32_t>(displacementsOffset));
+	putU32(out, 28, static_cast<uint32_t>(slotsOffset));
+	putU32(out, 32, static_cast<uint32_t>(stringsOffset));
+	putU32(out, 36, static_cast<uint32_t>(strings.size()));
+	putU32(out, 40, static_cast<uint32_t>(fileSize));
+
+	for (uint32_t i = 0; i < count; i++) {
+		const size_t record = recordsOffset + i * sizeof(AtlasRecord);
+
+		putU32(out, record, nameOffsets[i]);
+		putU32(out, record + 4, static_cast<uint32_t>(sprites.getName(i).size()));
+		putU16(out, record + 8, sprites.getPage(i));
+		putU16(out, record + 10, sprites.getRotation(i));
+		putU16(out, record + 12, sprites.getX(i));
+		putU16(out, record + 14, sprites.getY(i));
+		putU16(out, record + 16, sprites.getWidth(i));
+		putU16(out, record + 18, sprites.getHeight(i));
+		putU16(out, record + 20, sprites.getTrimX(i));
+		putU16(out, record + 22, sprites.getTrimY(i));
+		putU16(out, record + 24, sprites.getSourceWidth(i));
+		putU16(out, record + 26, sprites.getSourceHeight(i));
+		putU16(out, record + 28, sprites.getChannel(i));
+	}
+
+	for (size_t i = 0; i < displacements.size(); i++) putU32(out, displacementsOffset + i * 4, displacements[i]);
+	for (size_t i = 0; i < slots.size(); i++) putU32(out, slotsOffset + i * 4, slots[i]);
+	std::copy(strings.begin(), strings.end(), out.begin() + static_cast<long>(stringsOffset));
+
+	const std::string temporary = temporaryPath(path);
+	std::ofstream     file(temporary, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+	file.close();
+	if (!file) {
+		discardFile(temporary);
+		return false;
+	}
+	return commitFile(temporary, path);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "SpriteCatalog.h"
+
+/*
+   Write the binary sprite sheet read by AtlasReader.h: packed records, a string table and a perfect hash of the names.
+   Return false if two images have the same name, which is told to 'log', or the file cannot be written.
+*/
+bool writeAtlasBinary(const std::string& path, const SpriteCatalog& sprites, std::ostream& log);
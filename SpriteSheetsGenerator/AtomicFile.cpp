@@ -0,0 +1,50 @@
+#include "AtomicFile.h"
+
+#include <atomic>
+#include <filesystem>
+#include <system_error>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::atomic<unsigned long> temporaryCount{0};		// temporary files named by this process
+
+long processId()
+{
+#ifdef _WIN32
+	return _getpid();
+#else
+	return static_cast<long>(getpid());
+#endif
+}
+
+}
+
+std::string temporaryPath(const std::string& path)
+{
+	const std::filesystem::path file(path);
+	const unsigned long         count     = temporaryCount.fetch_add(1, std::memory_order_relaxed);
+	std::filesystem::path       temporary = file.parent_path();
+	temporary /= file.stem().string() + ".tmp." + std::to_string(processId()) + "." + std::to_string(count) + file.extension().string();
+	return temporary.string();
+}
+
+bool commitFile(const std::string& temporary, const std::string& path)
+{
+	// rename replaces the destination in one step, on Windows too
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error) discardFile(temporary);
+	return !error;
+}
+
+void discardFile(const std::string& temporary)
+{
+	std::error_code error;
+	std::filesystem::remove(temporary, error);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+
+/*
+   Outputs are written next to their final path then renamed over it, so a game that reloads the sheet while it is rebuilt
+   reads either the old file or the new one, never a file that is half written.
+*/
+
+/*
+   A new temporary file to write before calling commitFile, 'sheets/sheet.png' gives 'sheets/sheet.tmp.<pid>.<n>.png' to keep the
+   extension. Every call returns another name, so the concurrent builds of a build server never write the same temporary file.
+*/
+std::string temporaryPath(const std::string& path);
+
+/* Rename 'temporary' over 'path'. On failure the temporary file is deleted and 'path' is left untouched. */
+bool commitFile(const std::string& temporary, const std::string& path);
+
+/* Delete 'temporary' after a failed write. */
+void discardFile(const std::string& temporary);
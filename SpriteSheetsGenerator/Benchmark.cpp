@@ -0,0 +1,95 @@
+#include "Benchmark.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <optional>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Forward to the heap and count the calls
+class CountingResource : public std::pmr::memory_resource {
+public:
+	size_t allocations = 0;
+	size_t bytes       = 0;
+
+private:
+	void* do_allocate(const size_t size, const size_t alignment) override
+	{
+		allocations++;
+		bytes += size;
+		return std::pmr::new_delete_resource()->allocate(size, alignment);
+	}
+
+	void do_deallocate(void* p, const size_t size, const size_t alignment) override
+	{
+		std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+struct Result {
+	double ms          = 0;
+	size_t allocations = 0;
+	size_t bytes       = 0;
+	double checksum    = 0;	// sum of the costs, the same for both runs when the packers behave the same
+};
+
+const rbp::MaxRectsBinPack::FreeRectChoiceHeuristic HEURISTICS[] = {
+	rbp::MaxRectsBinPack::RectBestAreaFit,
+	rbp::MaxRectsBinPack::RectBestLongSideFit,
+	rbp::MaxRectsBinPack::RectBestShortSideFit,
+	rbp::MaxRectsBinPack::RectBottomLeftRule,
+	rbp::MaxRectsBinPack::RectContactPointRule,
+};
+
+Result run(const std::vector<rbp::RectSize>& sizes, const int binWidth, const int binHeight, const unsigned int rounds, const bool useArena)
+{
+	const std::vector<uint32_t> order = identityOrder(sizes.size());
+	CountingResource            counter;
+	Result                      result;
+
+	// The arena overflows to the counter so the allocations it could not serve are counted too
+	std::optional<PackArena> arena;
+	if (useArena) arena.emplace(1 << 20, &counter);
+
+	const auto start = Clock::now();
+	for (unsigned int round = 0; round < rounds; round++) {
+		for (const auto heuristic : HEURISTICS) {
+			std::pmr::memory_resource* scratch = &counter;
+			if (arena) {
+				arena->rewind();
+				scratch = arena->resource();
+			}
+			result.checksum += layoutCost(packLayout(sizes, order, {}, heuristic, binWidth, binHeight, scratch), binWidth, binHeight);
+		}
+	}
+	result.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	result.allocations = counter.allocations;
+	result.bytes       = counter.bytes;
+	return result;
+}
+
+}
+
+void benchmarkPacking(const std::vector<rbp::RectSize>& sizes, const int binWidth, const int binHeight, const unsigned int rounds)
+{
+	const Result heap   = run(sizes, binWidth, binHeight, rounds, false);
+	const Result pooled = run(sizes, binWidth, binHeight, rounds, true);
+
+	std::cout << std::fixed << std::setprecision(1)
+			  << "packs : " << rounds * std::size(HEURISTICS) << " of " << sizes.size() << " images\n"
+			  << "heap  : " << heap.ms << " ms, " << heap.allocations << " allocations, " << (heap.bytes >> 10) << " KB\n"
+			  << "arena : " << pooled.ms << " ms, " << pooled.allocations << " allocations, " << (pooled.bytes >> 10) << " KB\n"
+			  << std::defaultfloat;
+
+	if (heap.checksum != pooled.checksum) std::cout << "Error: the layouts differ between the heap and the arena\n";
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <vector>
+#include "Packer.h"
+
+/*
+   Pack the images 'rounds' times with every heuristic, once with the packers on the heap and once on a PackArena,
+   and print the time and the number of heap allocations of both.
+*/
+void benchmarkPacking(const std::vector<rbp::RectSize>& sizes, int binWidth, int binHeight, unsigned int rounds);
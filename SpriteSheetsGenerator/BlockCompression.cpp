@@ -0,0 +1,395 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include "Parallel.h"
+
+namespace {
+
+// The 16 pixels of a block in RGBA, row by row
+using Block = uint8_t[16][4];
+
+// Intensity modifiers of the ETC tables, the small and the large one, added to or subtracted from the base color of a subblock
+constexpr int ETC_MODIFIERS[8][2] = {{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}};
+
+// Modifiers of the EAC alpha tables, scaled by the multiplier of the block
+constexpr int EAC_MODIFIERS[16][8] = {
+	{-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12}, {-2, -5, -8, -13, 1, 4, 7, 12}, {-2, -4, -6, -13, 1, 3, 5, 12},
+	{-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10},  {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10},
+	{-2, -6, -8, -10, 1, 5, 7, 9},  {-2, -5, -8, -10, 1, 4, 7, 9},   {-2, -4, -8, -10, 1, 3, 7, 9},  {-2, -5, -7, -10, 1, 4, 6, 9},
+	{-3, -4, -7, -10, 2, 3, 6, 9},  {-1, -2, -3, -10, 0, 1, 2, 9},   {-4, -6, -8, -9, 3, 5, 7, 8},   {-3, -5, -7, -9, 2, 4, 6, 8}};
+
+uint16_t packColor565(const float color[3])
+{
+	const auto r = static_cast<uint16_t>(std::lround(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f));
+	const auto g = static_cast<uint16_t>(std::lround(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f));
+	const auto b = static_cast<uint16_t>(std::lround(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f));
+	return static_cast<uint16_t>(r << 11 | g << 5 | b);
+}
+
+void unpackColor565(const uint16_t packed, int color[3])
+{
+	const int r = packed >> 11 & 31;
+	const int g = packed >> 5 & 63;
+	const int b = packed & 31;
+	color[0] = r << 3 | r >> 2;
+	color[1] = g << 2 | g >> 4;
+	color[2] = b << 3 | b >> 2;
+}
+
+/* Encode the colors of the block in 8 bytes, the pixels with less than half alpha are made transparent if 'punchThrough'. */
+void encodeColors(const Block& block, const bool punchThrough, uint8_t* out)
+{
+	bool opaque[16];
+	int  count       = 0;
+	bool transparent = false;
+	for (int i = 0; i < 16; i++) {
+		opaque[i] = !punchThrough || block[i][3] >= 128;
+		count += opaque[i];
+		transparent |= !opaque[i];
+	}
+
+	// Nothing to fit: 3-color mode with every pixel transparent
+	if (count == 0) {
+		std::memset(out, 0, 4);
+		std::memset(out + 4, 0xFF, 4);
+		return;
+	}
+
+	// Mean and covariance of the colors
+	float mean[3] = {0.0f, 0.0f, 0.0f};
+	for (int i = 0; i < 16; i++) {
+		if (!opaque[i]) continue;
+		for (int c = 0; c < 3; c++) mean[c] += block[i][c];
+	}
+	for (float& m : mean) m /= static_cast<float>(count);
+
+	float covariance[6] = {};		// rr, rg, rb, gg, gb, bb
+	for (int i = 0; i < 16; i++) {
+		if (!opaque[i]) continue;
+		const float r = block[i][0] - mean[0], g = block[i][1] - mean[1], b = block[i][2] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+
+	// Principal axis by power iteration, a few steps are enough for 16 points. It starts from the two most distant colors: their
+	// difference lies in the spread of the colors so it is never orthogonal to the axis, like (1,1,1) is for pure red and pure green.
+	float axis[3]  = {0.0f, 0.0f, 0.0f};
+	int   farthest = 0;
+	for (int i = 0; i < 16; i++) {
+		for (int j = i + 1; j < 16 && opaque[i]; j++) {
+			if (!opaque[j]) continue;
+			const int dr = block[j][0] - block[i][0], dg = block[j][1] - block[i][1], db = block[j][2] - block[i][2];
+			if (const int distance = dr * dr + dg * dg + db * db; distance > farthest) {
+				farthest = distance;
+				axis[0]  = static_cast<float>(dr);
+				axis[1]  = static_cast<float>(dg);
+				axis[2]  = static_cast<float>(db);
+			}
+		}
+	}
+	for (int step = 0; step < 8; step++) {
+		const float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+		const float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+		const float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+		const float length = std::max({std::fabs(x), std::fabs(y), std::fabs(z)});
+		if (length == 0.0f) break;
+		axis[0] = x / length;
+		axis[1] = y / length;
+		axis[2] = z / length;
+	}
+
+	// Endpoints: the extreme projections of the colors on the axis
+	float low = 0.0f, high = 0.0f;
+	bool  first = true;
+	for (int i = 0; i < 16; i++) {
+		if (!opaque[i]) continue;
+		const float t = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+		low   = first ? t : std::min(low, t);
+		high  = first ? t : std::max(high, t);
+		first = false;
+	}
+	const float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	float       endpoints[2][3];
+	for (int c = 0; c < 3; c++) {
+		endpoints[0][c] = mean[c] + axis[c] * high / std::max(axisLength, 1e-6f);
+		endpoints[1][c] = mean[c] + axis[c] * low / std::max(axisLength, 1e-6f);
+	}
+
+	// No spread along the axis: the endpoints are the corners of the bounding box of the colors
+	if (high <= low) {
+		for (int c = 0; c < 3; c++) {
+			endpoints[0][c] = 0.0f;
+			endpoints[1][c] = 255.0f;
+			for (int i = 0; i < 16; i++) {
+				if (!opaque[i]) continue;
+				endpoints[0][c] = std::max(endpoints[0][c], static_cast<float>(block[i][c]));
+				endpoints[1][c] = std::min(endpoints[1][c], static_cast<float>(block[i][c]));
+			}
+		}
+	}
+
+	uint16_t color0 = packColor565(endpoints[0]);
+	uint16_t color1 = packColor565(endpoints[1]);
+
+	// color0 > color1 selects 4 colors, color0 <= color1 selects 3 colors and transparent black
+	if (transparent ? color0 > color1 : color0 < color1) std::swap(color0, color1);
+	const bool fourColors = color0 > color1;
+
+	int palette[4][3];
+	unpackColor565(color0, palette[0]);
+	unpackColor565(color1, palette[1]);
+	for (int c = 0; c < 3; c++) {
+		if (fourColors) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else {
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+
+	uint32_t indices = 0;
+	for (int i = 0; i < 16; i++) {
+		uint32_t best = 3;
+		if (opaque[i]) {
+			int bestError = -1;
+			for (uint32_t p = 0; p < (fourColors ? 4u : 3u); p++) {
+				const int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+				const int error = dr * dr + dg * dg + db * db;
+				if (bestError < 0 || error < bestError) {
+					bestError = error;
+					best      = p;
+				}
+			}
+		}
+		indices |= best << (2 * i);
+	}
+
+	out[0] = static_cast<uint8_t>(color0);
+	out[1] = static_cast<uint8_t>(color0 >> 8);
+	out[2] = static_cast<uint8_t>(color1);
+	out[3] = static_cast<uint8_t>(color1 >> 8);
+	for (int i = 0; i < 4; i++) out[4 + i] = static_cast<uint8_t>(indices >> (8 * i));
+}
+
+// The pixels of an ETC subblock fitted to one base color: the modifier table and the selector of every pixel of the block
+struct EtcFit {
+	int     table = 0;
+	int     error = 0;
+	uint8_t selectors[16] = {};
+};
+
+/* Fit the pixels of the subblock 'half' to 'base', the subblocks are the left and right halves, or the top and bottom if 'flip'. */
+EtcFit fitSubblock(const Block& block, const bool flip, const int half, const int base[3])
+{
+	EtcFit best;
+	best.error = std::numeric_limits<int>::max();
+	for (int table = 0; table < 8; table++) {
+		EtcFit fit;
+		fit.table = table;
+		for (int i = 0; i < 16 && fit.error < best.error; i++) {
+			if ((flip ? i / 8 : i % 4 / 2) != half) continue;
+
+			// Selectors 0 to 3 add the small modifier, add the large one, subtract the small one and subtract the large one
+			int bestError = std::numeric_limits<int>::max();
+			for (int selector = 0; selector < 4; selector++) {
+				const int modifier = selector & 2 ? -ETC_MODIFIERS[table][selector & 1] : ETC_MODIFIERS[table][selector & 1];
+				int       error    = 0;
+				for (int c = 0; c < 3; c++) {
+					const int d = std::clamp(base[c] + modifier, 0, 255) - block[i][c];
+					error += d * d;
+				}
+				if (error < bestError) {
+					bestError         = error;
+					fit.selectors[i] = static_cast<uint8_t>(selector);
+				}
+			}
+			fit.error += bestError;
+		}
+		if (fit.error < best.error) best = fit;
+	}
+	return best;
+}
+
+/*
+   Encode the colors of the block in 8 bytes of ETC2 with the individual or the differential mode it shares with ETC1, the base
+   color of each subblock is its mean. The T, H and planar modes of ETC2 are not searched.
+*/
+void encodeEtcColors(const Block& block, uint8_t* out)
+{
+	uint64_t bestBits  = 0;
+	int      bestError = std::numeric_limits<int>::max();
+	for (int flip = 0; flip < 2; flip++) {
+		int sums[2][3] = {};
+		for (int i = 0; i < 16; i++) {
+			for (int c = 0; c < 3; c++) sums[flip ? i / 8 : i % 4 / 2][c] += block[i][c];
+		}
+
+		// The differential mode has 5 bits per channel but the second color must be within [-4, 3] of the first
+		int  colors4[2][3], colors5[2][3];
+		bool differential = true;
+		for (int c = 0; c < 3; c++) {
+			for (int half = 0; half < 2; half++) {
+				colors4[half][c] = (sums[half][c] * 15 + 1020) / 2040;		// mean of 8 pixels rounded to 4 bits
+				colors5[half][c] = (sums[half][c] * 31 + 1020) / 2040;
+			}
+			differential = differential && colors5[1][c] - colors5[0][c] >= -4 && colors5[1][c] - colors5[0][c] <= 3;
+		}
+
+		for (int mode = 0; mode < (differential ? 2 : 1); mode++) {
+			int base[2][3];
+			for (int half = 0; half < 2; half++) {
+				for (int c = 0; c < 3; c++) {
+					base[half][c] = mode ? colors5[half][c] << 3 | colors5[half][c] >> 2 : colors4[half][c] << 4 | colors4[half][c];
+				}
+			}
+			const EtcFit fits[2] = {fitSubblock(block, flip, 0, base[0]), fitSubblock(block, flip, 1, base[1])};
+			if (fits[0].error + fits[1].error >= bestError) continue;
+			bestError = fits[0].error + fits[1].error;
+
+			// Big endian: the base colors, the tables, the mode and flip bits, then the high and the low bits of the selectors
+			uint64_t bits = static_cast<uint64_t>(fits[0].table) << 37 | static_cast<uint64_t>(fits[1].table) << 34
+			              | static_cast<uint64_t>(mode) << 33 | static_cast<uint64_t>(flip) << 32;
+			for (int c = 0; c < 3; c++) {
+				if (mode) {
+					bits |= static_cast<uint64_t>(colors5[0][c]) << (59 - 8 * c);
+					bits |= static_cast<uint64_t>((colors5[1][c] - colors5[0][c]) & 7) << (56 - 8 * c);
+				}
+				else {
+					bits |= static_cast<uint64_t>(colors4[0][c]) << (60 - 8 * c) | static_cast<uint64_t>(colors4[1][c]) << (56 - 8 * c);
+				}
+			}
+			for (int i = 0; i < 16; i++) {
+				const int      position = i % 4 * 4 + i / 4;		// the selectors are numbered column by column
+				const uint64_t selector = fits[flip ? i / 8 : i % 4 / 2].selectors[i];
+				bits |= (selector >> 1) << (16 + position) | (selector & 1) << position;
+			}
+			bestBits = bits;
+		}
+	}
+	for (int i = 0; i < 8; i++) out[i] = static_cast<uint8_t>(bestBits >> (56 - 8 * i));
+}
+
+/*
+   Encode the alpha of the block in 8 bytes of EAC. Every table is tried with the multipliers around the one that spans the
+   alpha of the block, the base is centered between the lowest and the highest alpha.
+*/
+void encodeEacAlpha(const Block& block, uint8_t* out)
+{
+	int low = 255, high = 0;
+	for (int i = 0; i < 16; i++) {
+		low  = std::min<int>(low, block[i][3]);
+		high = std::max<int>(high, block[i][3]);
+	}
+
+	// A flat block is exact with the modifier 0 of table 13
+	int     bestBase = high, bestMultiplier = 1, bestTable = 13, bestError = std::numeric_limits<int>::max();
+	uint8_t bestSelectors[16];
+	std::fill(std::begin(bestSelectors), std::end(bestSelectors), uint8_t(4));
+	for (int table = 0; table < 16 && low < high; table++) {
+		const int* modifiers = EAC_MODIFIERS[table];
+		const int  span      = modifiers[7] - modifiers[3];
+		const int  middle    = std::clamp((high - low + span / 2) / span, 1, 15);
+		for (int multiplier = std::max(1, middle - 1); multiplier <= std::min(15, middle + 1); multiplier++) {
+			const int base  = std::clamp((high + low - multiplier * (modifiers[7] + modifiers[3])) / 2, 0, 255);
+			int       error = 0;
+			uint8_t   selectors[16];
+			for (int i = 0; i < 16 && error < bestError; i++) {
+				int pixelError = std::numeric_limits<int>::max();
+				for (int selector = 0; selector < 8; selector++) {
+					const int d = std::clamp(base + modifiers[selector] * multiplier, 0, 255) - block[i][3];
+					if (d * d < pixelError) {
+						pixelError   = d * d;
+						selectors[i] = static_cast<uint8_t>(selector);
+					}
+				}
+				error += pixelError;
+			}
+			if (error >= bestError) continue;
+			bestError      = error;
+			bestBase       = base;
+			bestMultiplier = multiplier;
+			bestTable      = table;
+			std::copy(std::begin(selectors), std::end(selectors), std::begin(bestSelectors));
+		}
+	}
+
+	// Big endian: the base, the multiplier, the table, then 3 bits per pixel column by column
+	uint64_t bits = static_cast<uint64_t>(bestBase) << 56 | static_cast<uint64_t>(bestMultiplier) << 52 | static_cast<uint64_t>(bestTable) << 48;
+	for (int i = 0; i < 16; i++) bits |= static_cast<uint64_t>(bestSelectors[i]) << (45 - 3 * (i % 4 * 4 + i / 4));
+	for (int i = 0; i < 8; i++) out[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+}
+
+/* Encode the alpha of the block in 8 bytes, the 8-value mode between the lowest and the highest alpha. */
+void encodeAlpha(const Block& block, uint8_t* out)
+{
+	int alpha0 = 0, alpha1 = 255;
+	for (int i = 0; i < 16; i++) {
+		alpha0 = std::max<int>(alpha0, block[i][3]);
+		alpha1 = std::min<int>(alpha1, block[i][3]);
+	}
+
+	int palette[8] = {alpha0, alpha1};
+	for (int p = 1; p < 7; p++) palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+
+	uint64_t indices = 0;
+	for (int i = 0; i < 16; i++) {
+		uint64_t best      = 0;
+		int      bestError = 256;
+		for (uint64_t p = 0; p < (alpha0 == alpha1 ? 1u : 8u); p++) {
+			const int error = std::abs(block[i][3] - palette[p]);
+			if (error < bestError) {
+				bestError = error;
+				best      = p;
+			}
+		}
+		indices |= best << (3 * i);
+	}
+
+	out[0] = static_cast<uint8_t>(alpha0);
+	out[1] = static_cast<uint8_t>(alpha1);
+	for (int i = 0; i < 6; i++) out[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+}
+
+}
+
+void compressPixels(const PixelBuffer& pixels, const TextureFormat format, std::vector<uint8_t>& blocks, const unsigned int threads)
+{
+	const uint32_t blocksWide = (pixels.width() + 3) / 4;
+	const uint32_t blocksHigh = (pixels.height() + 3) / 4;
+	const uint32_t bytes      = texelBlockBytes(format);
+
+	blocks.resize(textureSize(format, pixels.width(), pixels.height()));
+
+	parallelFor(blocksHigh, threads, [&](const size_t by) {
+		Block block;
+		for (uint32_t bx = 0; bx < blocksWide; bx++) {
+			for (uint32_t i = 0; i < 16; i++) {
+				const uint32_t x = std::min(pixels.width() - 1, bx * 4 + i % 4);
+				const uint32_t y = std::min(pixels.height() - 1, static_cast<uint32_t>(by) * 4 + i / 4);
+				std::memcpy(block[i], pixels.row(y) + x * 4, 4);
+			}
+
+			uint8_t* out = blocks.data() + (by * blocksWide + bx) * bytes;
+			if (format == TextureFormat::Bc3) {
+				encodeAlpha(block, out);
+				encodeColors(block, false, out + 8);
+			}
+			else if (format == TextureFormat::Etc2) {
+				encodeEacAlpha(block, out);
+				encodeEtcColors(block, out + 8);
+			}
+			else {
+				encodeColors(block, true, out);
+			}
+		}
+	});
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "PixelPool.h"
+#include "TextureFormat.h"
+
+/*
+   Encode 'pixels' into 'blocks' of BC1, BC3 or ETC2, row of blocks after row of blocks like the GPUs expect them, the rows of blocks
+   are split between 'threads' workers. Blocks that cross the right or bottom edge repeat the last column or row.
+   The endpoints of each block are fitted along the principal axis of its colors; with BC1 a block that has pixels with less
+   than half alpha uses the 3-color mode and makes them transparent. ETC2 uses the two modes it shares with ETC1, with the mean
+   color of each half of the block, and an EAC alpha block.
+*/
+void compressPixels(const PixelBuffer& pixels, TextureFormat format, std::vector<uint8_t>& blocks, unsigned int threads);
@@ -0,0 +1,357 @@
+#include "BuildServer.h"
+
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include "FileScanner.h"
+#include "SheetBuilder.h"
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+/*
+   Protocol, one request per connection:
+	 client -> server   the number of arguments in decimal, then the working directory of the client, then every argument,
+	                    each one followed by '\0'
+	 server -> client   the output of the build, '\0', then the exit code in decimal, and the connection is closed
+*/
+
+#ifndef _WIN32
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// A request is a few paths and options, anything bigger is not a client of ours
+constexpr size_t MAX_REQUEST_BYTES = 1 << 16;
+
+// A client that connects and stops sending is dropped after this delay, instead of holding a worker forever
+constexpr time_t REQUEST_TIMEOUT_S = 10;
+
+// Layouts kept by the server before the cache is emptied
+constexpr size_t MAX_LAYOUTS = 64;
+
+// Decoded images shared by every request, keyed by path and checked against the size and the timestamp of the file
+class DecodeCache {
+public:
+	explicit DecodeCache(PixelPool& pool)
+		: m_pool(pool) {}
+
+	/*
+	   Fill 'images' with every image of 'folder', decoding only the files that changed on up to 'threads' workers.
+	   Return false if the pixel limit is reached.
+	*/
+	bool load(const std::string& folder, ImageCache& images, const unsigned int threads, std::ostream& log)
+	{
+		std::vector<ScannedFile> stale;		// files that are new or changed since they were cached
+		{
+			std::lock_guard<std::mutex>     lock(m_mutex);
+			const std::string               prefix = folder + "/";
+			std::unordered_set<std::string> present;		// keys of the files found by this scan
+			for (auto& file : scanImages(folder, 1)) {
+				const auto it = m_entries.find(*present.insert(prefix + file.path).first);
+				if (it != m_entries.end() && it->second.size == file.size && it->second.time == file.time) {
+					if (it->second.pixels) images.emplace(file.path, it->second.pixels);
+					continue;
+				}
+				stale.push_back(std::move(file));
+			}
+
+			// Forget the files of the folder that were deleted or renamed so their pixels go back to the pool
+			std::erase_if(m_entries, [&](const auto& entry) { return entry.first.starts_with(prefix) && !present.contains(entry.first); });
+		}
+		if (stale.empty()) return true;
+
+		// Decode outside of the lock, when the pool is full make room by forgetting every cached image and try once more
+		ImageCache decoded;
+		if (!loadImages(folder, stale, m_pool, decoded, threads, log)) {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_entries.clear();
+			}
+			decoded.clear();
+			if (!loadImages(folder, stale, m_pool, decoded, threads, log)) return false;
+		}
+
+		// Files that are not images are cached too so they are not decoded again
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (const auto& file : stale) {
+			Entry entry;
+			entry.size = file.size;
+			entry.time = file.time;
+			if (const auto it = decoded.find(file.path); it != decoded.end()) {
+				entry.pixels = it->second;
+				images.emplace(file.path, entry.pixels);
+			}
+			m_entries[folder + "/" + file.path] = std::move(entry);
+		}
+		return true;
+	}
+
+private:
+	struct Entry {
+		uintmax_t                          size = 0;
+		int64_t                            time = 0;
+		std::shared_ptr<const PixelBuffer> pixels;		// null if the file is not an image
+	};
+
+	PixelPool&                             m_pool;
+	std::mutex                             m_mutex;
+	std::unordered_map<std::string, Entry> m_entries;
+};
+
+// Layouts of the previous requests, keyed by the sizes of the images and the options that change the layout
+class LayoutCache {
+public:
+	Layout get(const std::vector<rbp::RectSize>& sizes, const std::vector<char>& masks, const Options& options, const unsigned int threads)
+	{
+		std::vector<unsigned int> key = {options.pageWidth, options.pageHeight, options.padding, options.extrude, options.mipIsolation, static_cast<unsigned int>(options.textureFormat), options.channelPack, options.optimizeMs, options.optimizeIterations};
+		for (const auto& size : sizes) {
+			key.push_back(static_cast<unsigned int>(size.width));
+			key.push_back(static_cast<unsigned int>(size.height));
+		}
+		key.insert(key.end(), masks.begin(), masks.end());
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (const auto it = m_layouts.find(key); it != m_layouts.end()) return it->second;
+		}
+
+		// Two requests for the same key may both pack, which is cheaper than holding the lock while packing
+		Layout layout = computeLayout(sizes, masks, options, threads);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_layouts.size() >= MAX_LAYOUTS) m_layouts.clear();
+		m_layouts.emplace(std::move(key), layout);
+		return layout;
+	}
+
+private:
+	std::mutex                                  m_mutex;
+	std::map<std::vector<unsigned int>, Layout> m_layouts;
+};
+
+// State shared by the workers of the server
+struct Server {
+	explicit Server(const size_t pixelLimit)
+		: pool(pixelLimit),
+		  decodeCache(pool) {}
+
+	PixelPool   pool;
+	DecodeCache decodeCache;
+	LayoutCache layoutCache;
+
+	std::mutex              mutex;
+	std::condition_variable ready;
+	std::deque<int>         connections;		// accepted sockets waiting for a worker
+};
+
+bool writeAll(const int socket, const std::string& data)
+{
+	for (size_t sent = 0; sent < data.size();) {
+		const ssize_t count = write(socket, data.data() + sent, data.size() - sent);
+		if (count <= 0) return false;
+		sent += static_cast<size_t>(count);
+	}
+	return true;
+}
+
+/* Read the arguments of a request, the working directory of the client first. Return false if the request is malformed. */
+bool readRequest(const int socket, std::vector<std::string>& args)
+{
+	std::string data;
+	char        buffer[4096];
+	size_t      strings  = 0;		// strings received, the number of arguments first
+	size_t      expected = 1;		// strings of the whole request, known once the number of arguments is read
+
+	// The request is complete when every string is, an empty argument is only an empty string
+	while (strings < expected) {
+		const ssize_t count = read(socket, buffer, sizeof(buffer));
+		if (count <= 0 || data.size() + static_cast<size_t>(count) > MAX_REQUEST_BYTES) return false;
+		data.append(buffer, static_cast<size_t>(count));
+		strings += static_cast<size_t>(std::count(buffer, buffer + count, '\0'));
+
+		if (expected == 1 && strings > 0) {
+			const char*  end   = data.data() + data.find('\0');
+			size_t       total = 0;
+			const auto   parse = std::from_chars(data.data(), end, total);
+			if (parse.ec != std::errc() || parse.ptr != end || total > MAX_REQUEST_BYTES) return false;
+			expected = total + 2;
+		}
+	}
+	if (strings != expected || data.back() != '\0') return false;
+
+	for (size_t start = data.find('\0') + 1; start < data.size();) {
+		const size_t end = data.find('\0', start);
+		args.push_back(data.substr(start, end - start));
+		start = end + 1;
+	}
+	return !args.empty();
+}
+
+/* Build the sheet of one request, write the output to 'log' and return the exit code. */
+int handleRequest(Server& server, const std::vector<std::string>& args, std::ostream& log)
+{
+	std::vector<char*> argv;
+	std::string        program = "SpriteSheetsGenerator";
+	argv.push_back(program.data());
+	for (size_t i = 1; i < args.size(); i++) argv.push_back(const_cast<char*>(args[i].c_str()));
+
+	// The server runs several requests at the same time, a request only uses more threads if it asks for them
+	Options options;
+	options.threads = 1;
+	if (!parseOptions(static_cast<int>(argv.size()), argv.data(), options, log)) return 1;
+
+	if (options.watch || options.verifyDeterminism || options.benchmarkPacking > 0 || !options.serve.empty() || !options.client.empty() || !options.trace.empty()) {
+		log << "Error: --watch, --verify-determinism, --benchmark-packing, --serve, --client and --trace cannot be sent to the build server\n";
+		return 1;
+	}
+
+	// Relative paths are relative to the folder of the client
+	const fs::path cwd = args[0];
+	options.input  = (cwd / options.input).string();
+	options.output = (cwd / options.output).string();
+	for (auto& map : options.maps) map.folder = (cwd / map.folder).string();
+	if (!options.header.empty()) options.header = (cwd / options.header).string();
+
+	ImageCache images;
+	if (!server.decodeCache.load(options.input, images, workerThreads(options), log)) return 1;
+
+	const Layout layout = server.layoutCache.get(getImageSizes(images), getMaskImages(images, options), options, workerThreads(options));
+	return buildSheet(images, layout, options, server.pool, log, nullptr) ? 0 : 1;
+}
+
+void runWorker(Server& server)
+{
+	while (true) {
+		int socket;
+		{
+			std::unique_lock<std::mutex> lock(server.mutex);
+			server.ready.wait(lock, [&server]() { return !server.connections.empty(); });
+			socket = server.connections.front();
+			server.connections.pop_front();
+		}
+
+		std::vector<std::string> args;
+		if (readRequest(socket, args)) {
+			std::ostringstream log;
+			const int          code = handleRequest(server, args, log);
+			writeAll(socket, log.str() + '\0' + std::to_string(code));
+		}
+		close(socket);
+	}
+}
+
+/* Fill the address of a socket, return false if the path is too long. */
+bool makeAddress(const std::string& path, sockaddr_un& address)
+{
+	address = {};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) return false;
+	path.copy(address.sun_path, path.size());
+	return true;
+}
+
+}
+
+int runBuildServer(const Options& options)
+{
+	// A client that goes away must not kill the server
+	std::signal(SIGPIPE, SIG_IGN);
+
+	sockaddr_un address;
+	const int   listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0 || !makeAddress(options.serve, address)) {
+		std::cout << "Error: cannot create the socket " << options.serve << "\n";
+		return 1;
+	}
+
+	// The socket file of a previous server is left behind when it is killed
+	unlink(options.serve.c_str());
+	if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0) {
+		std::cout << "Error: cannot listen on " << options.serve << "\n";
+		close(listener);
+		return 1;
+	}
+
+	Server                   server(static_cast<size_t>(options.pixelLimitMb) << 20);
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < workerThreads(options); i++) workers.emplace_back(runWorker, std::ref(server));
+	std::cout << "build server : " << workers.size() << " worker(s) on " << options.serve << "\n";
+
+	while (true) {
+		const int connection = accept(listener, nullptr, nullptr);
+		if (connection < 0) continue;
+
+		timeval timeout{};
+		timeout.tv_sec = REQUEST_TIMEOUT_S;
+		setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+		std::lock_guard<std::mutex> lock(server.mutex);
+		server.connections.push_back(connection);
+		server.ready.notify_one();
+	}
+}
+
+int runBuildClient(const Options& options)
+{
+	std::signal(SIGPIPE, SIG_IGN);
+
+	sockaddr_un address;
+	const int   connection = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (connection < 0 || !makeAddress(options.client, address) ||
+		connect(connection, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+		std::cout << "Error: cannot connect to the build server on " << options.client << "\n";
+		if (connection >= 0) close(connection);
+		return 1;
+	}
+
+	std::string request = std::to_string(options.forward.size()) + '\0' + fs::current_path().string() + '\0';
+	for (const auto& arg : options.forward) request += arg + '\0';
+
+	std::string response;
+	char        buffer[4096];
+	if (writeAll(connection, request)) {
+		for (ssize_t count; (count = read(connection, buffer, sizeof(buffer))) > 0;) response.append(buffer, static_cast<size_t>(count));
+	}
+	close(connection);
+
+	const size_t end = response.rfind('\0');
+	if (end == std::string::npos) {
+		std::cout << "Error: the build server closed the connection\n";
+		return 1;
+	}
+	std::cout << response.substr(0, end);
+	return std::atoi(response.c_str() + end + 1);
+}
+
+#else
+
+int runBuildServer(const Options&)
+{
+	std::cout << "Error: the build server needs Unix domain sockets, which this build does not support\n";
+	return 1;
+}
+
+int runBuildClient(const Options&)
+{
+	std::cout << "Error: the build server needs Unix domain sockets, which this build does not support\n";
+	return 1;
+}
+
+#endif
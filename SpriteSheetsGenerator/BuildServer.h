@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Options.h"
+
+/*
+   Stay resident on the Unix domain socket of options.serve and build the sheets requested by runBuildClient.
+   Decoded images and layouts are cached between the requests: building a folder again only decodes the images whose file changed,
+   and the packer does not run again when the sizes of the images and the packing options are the same.
+   Requests run concurrently on a fixed set of worker threads. Run until killed, return 1 if the socket cannot be opened.
+*/
+int runBuildServer(const Options& options);
+
+/* Send options.forward and the current folder to the build server of options.client, print its output and return its exit code. */
+int runBuildClient(const Options& options);
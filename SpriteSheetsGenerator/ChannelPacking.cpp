@@ -0,0 +1,95 @@
+#include "ChannelPacking.h"
+
+#include <cstring>
+
+int maskChannel(const PixelBuffer& sprite)
+{
+	const uint8_t* pixels = sprite.data();
+	const size_t   count  = static_cast<size_t>(sprite.width()) * sprite.height();
+	if (count == 0) return -1;
+
+	auto texel = [pixels](const size_t i) {
+		uint32_t p;
+		std::memcpy(&p, pixels + 4 * i, 4);
+		return p;
+	};
+
+	// Branch-free tests over the whole sprite so the loops are vectorized, the color of a shape is the one of its first visible pixel
+	uint32_t color = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (texel(i) >> 24 != 0) {
+			color = texel(i) & 0xFFFFFF;
+			break;
+		}
+	}
+
+	uint32_t notGray  = 0;
+	uint32_t notShape = 0;
+	for (size_t i = 0; i < count; i++) {
+		const uint32_t p = texel(i);
+		const uint32_t r = p & 0xFF, g = p >> 8 & 0xFF, b = p >> 16 & 0xFF, a = p >> 24;
+		notGray  |= (r ^ g) | (g ^ b) | (a ^ 0xFF);
+		notShape |= a != 0 ? (p & 0xFFFFFF) ^ color : 0;
+	}
+
+	if (notGray == 0) return 0;
+	if (notShape == 0) return 3;
+	return -1;
+}
+
+void blitChannel(const PixelBuffer& sprite, const int source, PixelBuffer& page, const Placement& placement)
+{
+	const rbp::Rect& rect  = placement.rect;
+	const uint8_t*   src   = sprite.data() + source;
+	const int        plane = placement.channel;
+
+	if (!placement.rotated) {
+		for (uint32_t y = 0; y < sprite.height(); y++) {
+			const uint8_t* in  = src + y * sprite.stride();
+			uint8_t*       out = page.row(static_cast<uint32_t>(rect.y) + y) + static_cast<size_t>(rect.x) * 4 + plane;
+			for (uint32_t x = 0; x < sprite.width(); x++) out[x * 4] = in[x * 4];
+		}
+		return;
+	}
+
+	// Turned clockwise: the source row y becomes the destination column (height - 1 - y)
+	for (uint32_t x = 0; x < sprite.width(); x++) {
+		uint8_t* out = page.row(static_cast<uint32_t>(rect.y) + x) + static_cast<size_t>(rect.x) * 4 + plane;
+		for (uint32_t y = 0; y < sprite.height(); y++) {
+			out[(sprite.height() - 1 - y) * 4] = src[y * sprite.stride() + x * 4];
+		}
+	}
+}
+
+void extrudeChannel(PixelBuffer& page, const rbp::Rect& rect, const int extrude, const int channel)
+{
+	if (extrude <= 0 || rect.width <= 0 || rect.height <= 0) return;
+
+	const auto border = static_cast<uint32_t>(extrude);
+	const auto x      = static_cast<uint32_t>(rect.x);
+	const auto y      = static_cast<uint32_t>(rect.y);
+	const auto width  = static_cast<uint32_t>(rect.width);
+	const auto height = static_cast<uint32_t>(rect.height);
+
+	// Left and right, then the first and last rows already extruded for the corners, like extrudeEdges
+	for (uint32_t row = y; row < y + height; row++) {
+		uint8_t*      line  = page.row(row) + channel;
+		const uint8_t left  = line[x * 4];
+		const uint8_t right = line[(x + width - 1) * 4];
+		for (uint32_t i = 1; i <= border; i++) {
+			line[(x - i) * 4]             = left;
+			line[(x + width - 1 + i) * 4] = right;
+		}
+	}
+
+	for (uint32_t i = 1; i <= border; i++) {
+		const uint8_t* top    = page.row(y) + channel;
+		const uint8_t* bottom = page.row(y + height - 1) + channel;
+		uint8_t*       above  = page.row(y - i) + channel;
+		uint8_t*       below  = page.row(y + height - 1 + i) + channel;
+		for (uint32_t column = x - border; column < x + width + border; column++) {
+			above[column * 4] = top[column * 4];
+			below[column * 4] = bottom[column * 4];
+		}
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Packer.h"
+#include "PixelPool.h"
+
+/*
+   Channel packing stores the sprites that only carry one channel, such as grayscale masks and single color shapes, in one plane
+   of a page instead of a whole pixel. Those sprites are packed on their own in four layers per page, the layer of a sprite is
+   the channel of the page it is written to.
+*/
+
+/*
+   The channel of 'sprite' that carries its content, or -1 if it needs every channel:
+   0 (red) for an opaque gray sprite, 3 (alpha) for a shape of a single color, whose color is left to the shader.
+*/
+int maskChannel(const PixelBuffer& sprite);
+
+/* Copy the channel 'source' of the sprite into the channel of its placement on the page, turned like blitSprite. */
+void blitChannel(const PixelBuffer& sprite, int source, PixelBuffer& page, const Placement& placement);
+
+/* extrudeEdges for a single channel of the page, the other channels belong to other sprites and are left untouched. */
+void extrudeChannel(PixelBuffer& page, const rbp::Rect& rect, int extrude, int channel);
@@ -0,0 +1,131 @@
+#include "Compositor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COMPOSITOR_SSE2
+#endif
+
+namespace {
+
+// Sprites from this size on are written around the cache, a page of them would only evict each other
+constexpr size_t STREAM_BYTES = 512 * 1024;
+
+/* Copy a row of pixels to the page, with non-temporal stores if 'stream' and the CPU has them. */
+void copyRow(uint8_t* out, const uint8_t* in, const size_t bytes, const bool stream)
+{
+#ifdef COMPOSITOR_SSE2
+	if (stream) {
+		// Stores go 16 bytes at a time to aligned addresses, the unaligned head and tail are copied normally
+		const size_t head = std::min(bytes, (16 - reinterpret_cast<uintptr_t>(out) % 16) % 16);
+		std::memcpy(out, in, head);
+		size_t i = head;
+		for (; i + 16 <= bytes; i += 16) {
+			_mm_stream_si128(reinterpret_cast<__m128i*>(out + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+		}
+		std::memcpy(out + i, in + i, bytes - i);
+		return;
+	}
+#endif
+	(void)stream;
+	std::memcpy(out, in, bytes);
+}
+
+/* Repeat the texel at 'texel' 'count' times from 'out', four texels per store when the CPU has 16-byte stores. */
+void fillTexels(uint8_t* out, const uint8_t* texel, const uint32_t count)
+{
+	uint32_t i = 0;
+#ifdef COMPOSITOR_SSE2
+	int32_t value;
+	std::memcpy(&value, texel, 4);
+	const __m128i run = _mm_set1_epi32(value);
+	for (; i + 4 <= count; i += 4) _mm_storeu_si128(reinterpret_cast<__m128i*>(out + static_cast<size_t>(i) * 4), run);
+#endif
+	for (; i < count; i++) std::memcpy(out + static_cast<size_t>(i) * 4, texel, 4);
+}
+
+}
+
+void clearPage(PixelBuffer& page)
+{
+	std::memset(page.data(), 0, page.bytes());
+}
+
+void blitSprite(const PixelBuffer& sprite, PixelBuffer& page, const Placement& placement)
+{
+	const rbp::Rect& rect = placement.rect;
+
+	if (!placement.rotated) {
+		const bool stream = sprite.bytes() >= STREAM_BYTES;
+		for (uint32_t y = 0; y < sprite.height(); y++) {
+			copyRow(page.row(static_cast<uint32_t>(rect.y) + y) + static_cast<size_t>(rect.x) * 4, sprite.row(y), sprite.stride(), stream);
+		}
+#ifdef COMPOSITOR_SSE2
+		// Make the streamed rows visible before the page is handed to the next stage
+		if (stream) _mm_sfence();
+#endif
+		return;
+	}
+
+	// Turned clockwise: the source row y becomes the destination column (height - 1 - y)
+	for (uint32_t x = 0; x < sprite.width(); x++) {
+		uint8_t* dst = page.row(static_cast<uint32_t>(rect.y) + x) + static_cast<size_t>(rect.x) * 4;
+		for (uint32_t y = 0; y < sprite.height(); y++) {
+			std::memcpy(dst + static_cast<size_t>(sprite.height() - 1 - y) * 4, sprite.row(y) + static_cast<size_t>(x) * 4, 4);
+		}
+	}
+}
+
+void extrudeEdges(PixelBuffer& page, const rbp::Rect& rect, const int extrude)
+{
+	if (extrude <= 0 || rect.width <= 0 || rect.height <= 0) return;
+
+	const auto border = static_cast<uint32_t>(extrude);
+	const auto x      = static_cast<uint32_t>(rect.x);
+	const auto y      = static_cast<uint32_t>(rect.y);
+	const auto width  = static_cast<uint32_t>(rect.width);
+	const auto height = static_cast<uint32_t>(rect.height);
+
+	// Left and right: the edge texel of each row broadcast over the border
+	for (uint32_t row = y; row < y + height; row++) {
+		uint8_t* line = page.row(row);
+		fillTexels(line + static_cast<size_t>(x - border) * 4, line + static_cast<size_t>(x) * 4, border);
+		fillTexels(line + static_cast<size_t>(x + width) * 4, line + static_cast<size_t>(x + width - 1) * 4, border);
+	}
+
+	// Top and bottom: copy the first and last rows, already extruded, so the corners come for free
+	const size_t left  = static_cast<size_t>(x - border) * 4;
+	const size_t bytes = static_cast<size_t>(width + 2 * border) * 4;
+	for (uint32_t i = 1; i <= border; i++) {
+		std::memcpy(page.row(y - i) + left, page.row(y) + left, bytes);
+		std::memcpy(page.row(y + height - 1 + i) + left, page.row(y + height - 1) + left, bytes);
+	}
+}
+
+std::vector<std::vector<size_t>> partitionPlacements(const std::vector<Placement>& placements, const PixelBuffer& page, const unsigned int workers)
+{
+	auto address = [&](const size_t i) {
+		return static_cast<size_t>(placements[i].rect.y) * page.width() + static_cast<size_t>(placements[i].rect.x);
+	};
+
+	std::vector<size_t> order(placements.size());
+	std::iota(order.begin(), order.end(), size_t{0});
+	std::sort(order.begin(), order.end(), [&](const size_t a, const size_t b) { return address(a) < address(b); });
+
+	size_t total = 0;
+	for (const auto& placement : placements) total += static_cast<size_t>(placement.rect.width) * placement.rect.height;
+
+	// Close a part once it holds its share of the pixels, a sprite bigger than a share makes a part of its own
+	const size_t                     parts = std::max<size_t>(1, std::min<size_t>(workers, placements.size()));
+	std::vector<std::vector<size_t>> partition(1);
+	size_t                           drawn = 0;
+	for (const size_t i : order) {
+		if (!partition.back().empty() && partition.size() < parts && drawn * parts >= total * partition.size()) partition.emplace_back();
+		partition.back().push_back(i);
+		drawn += static_cast<size_t>(placements[i].rect.width) * placements[i].rect.height;
+	}
+	return partition;
+}
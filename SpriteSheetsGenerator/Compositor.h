@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include "Packer.h"
+#include "PixelPool.h"
+
+/* Fill the page with transparent pixels. */
+void clearPage(PixelBuffer& page);
+
+/*
+   Copy the pixels of a sprite into its packed rectangle of the page, turned 90 degrees clockwise if the placement is rotated.
+   Pixels are copied as they are, without blending, since the rectangles of a page never overlap. The rows of a big sprite are
+   written with non-temporal stores where the CPU has them, so that it does not evict the rest of the page from the cache.
+*/
+void blitSprite(const PixelBuffer& sprite, PixelBuffer& page, const Placement& placement);
+
+/*
+   Repeat the outermost pixels of the sprite in 'rect' over 'extrude' pixels around it, corners included, so that bilinear filtering
+   and mipmaps sample the edge of the sprite instead of its neighbours. The page must have room for the border.
+*/
+void extrudeEdges(PixelBuffer& page, const rbp::Rect& rect, int extrude);
+
+/*
+   Split the sprites of a page between up to 'workers' so that they can be drawn at the same time without locks: the placements are
+   sorted by the address of their first pixel, so each worker writes a band of the page, and cut where the workers get about the same
+   number of pixels. Return the indices in 'placements' of the sprites of every worker.
+*/
+std::vector<std::vector<size_t>> partitionPlacements(const std::vector<Placement>& placements, const PixelBuffer& page, unsigned int workers);
@@ -0,0 +1,172 @@
+#include "DirectoryWatcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <system_error>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Delay between two scans when inotify is not available
+constexpr unsigned int SCAN_INTERVAL_MS = 250;
+
+#ifdef __linux__
+constexpr uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+#endif
+
+std::string joinPath(const std::string& directory, const std::string& name)
+{
+	return directory.empty() ? name : directory + "/" + name;
+}
+
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+#ifdef __linux__
+	if (m_inotify >= 0) close(m_inotify);
+#endif
+}
+
+bool DirectoryWatcher::open(const std::string& directory)
+{
+	std::error_code error;
+	if (!fs::is_directory(directory, error)) return false;
+	m_directory = directory;
+
+	std::vector<std::string> ignored;
+#ifdef __linux__
+	m_inotify = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+	if (m_inotify < 0) return false;
+	watchTree("", ignored);
+#else
+	rescan(ignored);
+#endif
+	return true;
+}
+
+std::vector<std::string> DirectoryWatcher::wait(const unsigned int quietMs)
+{
+	std::vector<std::string> changes;
+
+#ifdef __linux__
+	// The first event can take forever, after that stop as soon as the directory is quiet
+	while (!readEvents(-1, changes)) {}
+	while (readEvents(static_cast<int>(quietMs), changes)) {}
+#else
+	while (!rescan(changes)) std::this_thread::sleep_for(std::chrono::milliseconds(SCAN_INTERVAL_MS));
+
+	auto quietSince = std::chrono::steady_clock::now();
+	while (std::chrono::steady_clock::now() - quietSince < std::chrono::milliseconds(quietMs)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(std::min(quietMs, SCAN_INTERVAL_MS)));
+		if (rescan(changes)) quietSince = std::chrono::steady_clock::now();
+	}
+#endif
+
+	std::sort(changes.begin(), changes.end());
+	changes.erase(std::unique(changes.begin(), changes.end()), changes.end());
+	return changes;
+}
+
+bool DirectoryWatcher::rescan(std::vector<std::string>& changes)
+{
+	std::vector<ScannedFile> files = scanImages(m_directory, 1);
+
+	// Both scans are sorted by path, walk them side by side
+	const size_t before = changes.size();
+	auto         old    = m_files.begin();
+	for (const auto& file : files) {
+		for (; old != m_files.end() && old->path < file.path; ++old) changes.push_back(old->path);
+
+		if (old != m_files.end() && old->path == file.path) {
+			if (old->size != file.size || old->time != file.time) changes.push_back(file.path);
+			++old;
+		}
+		else {
+			changes.push_back(file.path);
+		}
+	}
+	for (; old != m_files.end(); ++old) changes.push_back(old->path);
+
+	m_files = std::move(files);
+	return changes.size() != before;
+}
+
+void DirectoryWatcher::watchTree(const std::string& relative, std::vector<std::string>& changes)
+{
+#ifdef __linux__
+	const std::string path = relative.empty() ? m_directory : m_directory + "/" + relative;
+	const int         watch = inotify_add_watch(m_inotify, path.c_str(), WATCH_MASK);
+	if (watch < 0) return;
+	m_watches[watch] = relative;
+
+	// Files created before the watch was added would be missed otherwise
+	std::error_code error;
+	for (fs::directory_iterator it(path, error), end; !error && it != end; it.increment(error)) {
+		const std::string name = joinPath(relative, it->path().filename().string());
+		if (it->is_directory(error)) watchTree(name, changes);
+		else changes.push_back(name);
+	}
+#else
+	(void)relative;
+	(void)changes;
+#endif
+}
+
+bool DirectoryWatcher::readEvents(const int timeoutMs, std::vector<std::string>& changes)
+{
+#ifdef __linux__
+	pollfd descriptor{m_inotify, POLLIN, 0};
+	if (poll(&descriptor, 1, timeoutMs) <= 0) return false;
+
+	alignas(inotify_event) char buffer[16384];
+	bool                        any = false;
+
+	for (ssize_t length; (length = read(m_inotify, buffer, sizeof(buffer))) > 0;) {
+		for (ssize_t offset = 0; offset < length;) {
+			const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+			// Events were lost, report every file again
+			if (event->mask & IN_Q_OVERFLOW) {
+				watchTree("", changes);
+				any = true;
+				continue;
+			}
+
+			const auto directory = m_watches.find(event->wd);
+			if (event->mask & IN_IGNORED) {
+				if (directory != m_watches.end()) m_watches.erase(directory);
+				continue;
+			}
+			if (directory == m_watches.end() || event->len == 0) continue;
+
+			const std::string name = joinPath(directory->second, event->name);
+			if (event->mask & IN_ISDIR) {
+				// A new directory is watched too, the files of a directory moved away are not reported one by one
+				// so the caller has to check which files are gone
+				if (event->mask & (IN_CREATE | IN_MOVED_TO)) watchTree(name, changes);
+				else changes.push_back(name);
+			}
+			else {
+				changes.push_back(name);
+			}
+			any = true;
+		}
+	}
+	return any;
+#else
+	(void)timeoutMs;
+	(void)changes;
+	return false;
+#endif
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include "FileScanner.h"
+
+/*
+   Watch a directory and its subdirectories for files that are written, created, moved or deleted.
+   On Linux the changes come from inotify, on the other systems the images are scanned for new timestamps a few times per second.
+*/
+class DirectoryWatcher {
+public:
+	DirectoryWatcher() = default;
+	DirectoryWatcher(const DirectoryWatcher&) = delete;
+	DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+	~DirectoryWatcher();
+
+	/* Start watching 'directory', return false if it cannot be watched. */
+	bool open(const std::string& directory);
+
+	/*
+	   Block until a file changes, then wait until nothing changed for 'quietMs' milliseconds so that a burst of saves gives one rebuild.
+	   Return the touched paths relative to the directory, sorted and without duplicates. A path may name a file deleted since,
+	   or a directory that was deleted or moved away with its files.
+	*/
+	std::vector<std::string> wait(unsigned int quietMs);
+
+private:
+	/* Add the files that changed since the last scan to 'changes', return true if there were some. */
+	bool rescan(std::vector<std::string>& changes);
+
+	/* Watch 'relative' and its subdirectories with inotify, the files found are added to 'changes'. */
+	void watchTree(const std::string& relative, std::vector<std::string>& changes);
+
+	/* Read the pending inotify events into 'changes', waiting at most 'timeoutMs' (-1 for no limit). */
+	bool readEvents(int timeoutMs, std::vector<std::string>& changes);
+
+	std::string                      m_directory;
+	int                              m_inotify = -1;
+	std::map<int, std::string>       m_watches;	// inotify watch descriptor to the directory it watches, relative
+	std::vector<ScannedFile>         m_files;		// every image seen by the last scan, for the scanning fallback
+};
@@ -0,0 +1,435 @@
+#include "FileReader.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include "Parallel.h"
+#include "Trace.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstdlib>
+#include <initializer_list>
+#include <memory>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr unsigned int IO_THREADS     = 4;				// blocking readers when io_uring is not available
+constexpr size_t       BUFFERED_BYTES = 64 << 20;		// files read and not consumed yet, the reader waits beyond
+
+// A file read in memory, waiting for a worker
+struct ReadFile {
+	size_t               index    = 0;
+	std::vector<uint8_t> data;
+	size_t               reserved = 0;		// bytes of the budget taken by the file
+};
+
+// Files handed from the reader to the workers, with the budget of the bytes in memory
+class ReadQueue {
+public:
+	explicit ReadQueue(const size_t count)
+		: m_remaining(count) {}
+
+	/* Take 'bytes' of the budget, waiting for the workers if it is spent. A file bigger than the budget goes through alone. */
+	void reserve(const size_t bytes)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_room.wait(lock, [&]() { return m_buffered == 0 || m_buffered + bytes <= BUFFERED_BYTES; });
+		m_buffered += bytes;
+	}
+
+	/* Same as reserve without waiting, return false if the budget is spent. */
+	bool tryReserve(const size_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_buffered != 0 && m_buffered + bytes > BUFFERED_BYTES) return false;
+		m_buffered += bytes;
+		return true;
+	}
+
+	void push(ReadFile&& file)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_files.push_back(std::move(file));
+		m_ready.notify_one();
+	}
+
+	/* The next file to consume, false once every file was handed out. */
+	bool pop(ReadFile& file)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_ready.wait(lock, [&]() { return !m_files.empty() || m_remaining == 0; });
+		if (m_files.empty()) return false;
+
+		file = std::move(m_files.front());
+		m_files.pop_front();
+		if (--m_remaining == 0) m_ready.notify_all();
+		return true;
+	}
+
+	/* Give back the budget of a consumed file. */
+	void release(const size_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_buffered -= bytes;
+		m_room.notify_all();
+	}
+
+private:
+	std::mutex              m_mutex;
+	std::condition_variable m_ready;
+	std::condition_variable m_room;
+	std::deque<ReadFile>    m_files;
+	size_t                  m_buffered = 0;
+	size_t                  m_remaining;		// files not handed to a worker yet
+};
+
+/* Read a whole file with blocking calls, empty if it cannot be read. */
+std::vector<uint8_t> readWholeFile(const std::string& path, const size_t size)
+{
+	std::vector<uint8_t> data(size);
+	size_t               done = 0;
+
+#ifdef __linux__
+	const int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (file < 0) return {};
+
+	// The file is read once from start to end, let the kernel fetch all of it
+	posix_fadvise(file, 0, static_cast<off_t>(size), POSIX_FADV_SEQUENTIAL);
+	posix_fadvise(file, 0, static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+	while (done < size) {
+		const ssize_t bytes = ::read(file, data.data() + done, size - done);
+		if (bytes < 0 && errno == EINTR) continue;
+		if (bytes <= 0) break;
+		done += static_cast<size_t>(bytes);
+	}
+	::close(file);
+#else
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) return {};
+	file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(size));
+	done = static_cast<size_t>(file.gcount());
+#endif
+
+	data.resize(done);
+	return data;
+}
+
+/* Read the files from 'first' on with a few threads making blocking calls. */
+void readBlocking(const std::vector<std::string>& paths, const std::vector<uintmax_t>& sizes, const size_t first, ReadQueue& queue)
+{
+	parallelFor(paths.size() - first, IO_THREADS, [&](const size_t i) {
+		ReadFile file;
+		file.index    = first + i;
+		file.reserved = static_cast<size_t>(sizes[file.index]);
+		queue.reserve(file.reserved);
+		file.data = readWholeFile(paths[file.index], file.reserved);
+		queue.push(std::move(file));
+	});
+}
+
+#ifdef __linux__
+
+// Minimal io_uring without liburing: the rings are mapped once, requests are written to the shared submission queue
+class Ring {
+public:
+	Ring() = default;
+	Ring(const Ring&) = delete;
+	Ring& operator=(const Ring&) = delete;
+
+	~Ring()
+	{
+		if (m_sqes) munmap(m_sqes, m_sqesBytes);
+		if (m_cq && m_cq != m_sq) munmap(m_cq, m_cqBytes);
+		if (m_sq) munmap(m_sq, m_sqBytes);
+		if (m_fd >= 0) ::close(m_fd);
+	}
+
+	/* Create the ring, false if the kernel does not have io_uring or forbids it. */
+	bool open(const unsigned int entries)
+	{
+		io_uring_params params{};
+		m_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+		if (m_fd < 0) return false;
+
+		m_sqBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		m_cqBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		if (params.features & IORING_FEAT_SINGLE_MMAP) m_sqBytes = m_cqBytes = std::max(m_sqBytes, m_cqBytes);
+
+		m_sq = map(m_sqBytes, IORING_OFF_SQ_RING);
+		m_cq = params.features & IORING_FEAT_SINGLE_MMAP ? m_sq : map(m_cqBytes, IORING_OFF_CQ_RING);
+		m_sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+		m_sqes      = static_cast<io_uring_sqe*>(map(m_sqesBytes, IORING_OFF_SQES));
+		if (!m_sq || !m_cq || !m_sqes) return false;
+
+		m_sqHead  = reinterpret_cast<unsigned*>(static_cast<uint8_t*>(m_sq) + params.sq_off.head);
+		m_sqTail  = reinterpret_cast<unsigned*>(static_cast<uint8_t*>(m_sq) + params.sq_off.tail);
+		m_sqMask  = *reinterpret_cast<unsigned*>(static_cast<uint8_t*>(m_sq) + params.sq_off.ring_mask);
+		m_sqArray = reinterpret_cast<unsigned*>(static_cast<uint8_t*>(m_sq) + params.sq_off.array);
+		m_cqHead  = reinterpret_cast<unsigned*>(static_cast<uint8_t*>(m_cq) + params.cq_off.head);
+		m_cqTail  = reinterpret_cast<unsigned*>(static_cast<uint8_t*>(m_cq) + params.cq_off.tail);
+		m_cqMask  = *reinterpret_cast<unsigned*>(static_cast<uint8_t*>(m_cq) + params.cq_off.ring_mask);
+		m_cqes    = reinterpret_cast<io_uring_cqe*>(static_cast<uint8_t*>(m_cq) + params.cq_off.cqes);
+		m_entries = params.sq_entries;
+		m_tail    = *m_sqTail;
+		return true;
+	}
+
+	unsigned int entries() const { return m_entries; }
+
+	/* True if the kernel runs every one of 'opcodes'. Kernels before 5.6 cannot be asked and have none of the file operations. */
+	bool supports(const std::initializer_list<uint8_t> opcodes) const
+	{
+		constexpr unsigned int OPS   = 256;		// an opcode is one byte
+		const size_t           bytes = sizeof(io_uring_probe) + OPS * sizeof(io_uring_probe_op);
+		std::unique_ptr<io_uring_probe, decltype(&std::free)> probe(static_cast<io_uring_probe*>(std::calloc(1, bytes)), &std::free);
+		if (!probe || syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PROBE, probe.get(), OPS) < 0) return false;
+
+		for (const uint8_t opcode : opcodes) {
+			if (opcode > probe->last_op || !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED)) return false;
+		}
+		return true;
+	}
+
+	/* A cleared request at the end of the submission queue, the caller keeps fewer requests in flight than entries(). */
+	io_uring_sqe* next()
+	{
+		const unsigned index = m_tail & m_sqMask;
+		m_sqArray[index]     = index;
+		m_tail++;
+		std::memset(&m_sqes[index], 0, sizeof(io_uring_sqe));
+		return &m_sqes[index];
+	}
+
+	/* Submit the queued requests and wait for at least one completion. */
+	bool submitAndWait()
+	{
+		const unsigned queued = m_tail - m_submitted;
+		__atomic_store_n(m_sqTail, m_tail, __ATOMIC_RELEASE);
+		while (true) {
+			const long result = syscall(__NR_io_uring_enter, m_fd, queued, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+			if (result >= 0) break;
+			if (errno != EINTR) return false;
+		}
+		m_submitted = m_tail;
+		return true;
+	}
+
+	/* Pop one completion, false if there is none. */
+	bool reap(io_uring_cqe& completion)
+	{
+		const unsigned head = *m_cqHead;
+		if (head == __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE)) return false;
+		completion = m_cqes[head & m_cqMask];
+		__atomic_store_n(m_cqHead, head + 1, __ATOMIC_RELEASE);
+		return true;
+	}
+
+private:
+	void* map(const size_t bytes, const off_t offset) const
+	{
+		void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, offset);
+		return memory == MAP_FAILED ? nullptr : memory;
+	}
+
+	int           m_fd        = -1;
+	void*         m_sq        = nullptr;
+	void*         m_cq        = nullptr;
+	io_uring_sqe* m_sqes      = nullptr;
+	size_t        m_sqBytes   = 0;
+	size_t        m_cqBytes   = 0;
+	size_t        m_sqesBytes = 0;
+	unsigned*     m_sqHead    = nullptr;
+	unsigned*     m_sqTail    = nullptr;
+	unsigned*     m_sqArray   = nullptr;
+	unsigned      m_sqMask    = 0;
+	unsigned*     m_cqHead    = nullptr;
+	unsigned*     m_cqTail    = nullptr;
+	unsigned      m_cqMask    = 0;
+	io_uring_cqe* m_cqes      = nullptr;
+	unsigned      m_entries   = 0;
+	unsigned      m_tail      = 0;		// local tail, published by submitAndWait
+	unsigned      m_submitted = 0;
+};
+
+constexpr unsigned int RING_ENTRIES = 64;
+
+// Kind of a request, in the low bits of its user data
+enum RingOp : uint64_t {
+	OpOpen,
+	OpHint,
+	OpRead
+};
+
+/*
+   Read the files through io_uring: up to half the ring of files are opened at once, then each one gets a readahead hint linked
+   to a read of the whole file. Return the index of the first file left to the blocking reader, 0 if the ring cannot be created or
+   the kernel lacks one of the operations, every file once they are all read. A file whose open or read the kernel refuses is read
+   with blocking calls instead.
+*/
+size_t readWithRing(const std::vector<std::string>& paths, const std::vector<uintmax_t>& sizes, ReadQueue& queue)
+{
+	struct Pending {
+		int      fd       = -1;
+		size_t   done     = 0;		// bytes read so far
+		bool     finished = false;
+		ReadFile file;
+	};
+	std::vector<Pending>              pending(paths.size());
+	std::vector<std::vector<uint8_t>> abandoned;		// buffers of the requests of a broken ring
+
+	Ring ring;
+	if (!ring.open(RING_ENTRIES) || !ring.supports({IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_FADVISE})) return 0;
+
+	size_t   next     = 0;		// next file to open
+	size_t   finished = 0;
+	unsigned inFlight = 0;		// requests in the ring
+
+	auto finish = [&](const size_t index) {
+		Pending& state = pending[index];
+		if (state.fd >= 0) ::close(state.fd);
+		state.fd       = -1;
+		state.finished = true;
+		state.file.data.resize(state.done);
+		queue.push(std::move(state.file));
+		finished++;
+	};
+	auto finishBlocking = [&](const size_t index) {
+		Pending& state  = pending[index];
+		state.file.data = readWholeFile(paths[index], state.file.reserved);
+		state.done      = state.file.data.size();
+		finish(index);
+	};
+	auto queueRead = [&](const size_t index, const bool hint) {
+		Pending& state = pending[index];
+		if (hint) {
+			io_uring_sqe* advice   = ring.next();
+			advice->opcode         = IORING_OP_FADVISE;
+			advice->fd             = state.fd;
+			advice->len            = static_cast<uint32_t>(state.file.reserved);
+			advice->fadvise_advice = POSIX_FADV_WILLNEED;
+			advice->flags          = IOSQE_IO_LINK;
+			advice->user_data      = index << 2 | OpHint;
+			inFlight++;
+		}
+		io_uring_sqe* read = ring.next();
+		read->opcode       = IORING_OP_READ;
+		read->fd           = state.fd;
+		read->addr         = reinterpret_cast<uint64_t>(state.file.data.data() + state.done);
+		read->len          = static_cast<uint32_t>(std::min<size_t>(state.file.reserved - state.done, 1u << 30));
+		read->off          = state.done;
+		read->user_data    = index << 2 | OpRead;
+		inFlight++;
+	};
+
+	while (finished < paths.size()) {
+		// A file has at most two requests in flight, its hint and its read, so half the ring of files fills it
+		while (next < paths.size() && next - finished < ring.entries() / 2) {
+			const size_t bytes = static_cast<size_t>(sizes[next]);
+			if (inFlight > 0 && !queue.tryReserve(bytes)) break;
+			if (inFlight == 0) queue.reserve(bytes);
+
+			Pending& state      = pending[next];
+			state.file.index    = next;
+			state.file.reserved = bytes;
+
+			io_uring_sqe* open = ring.next();
+			open->opcode       = IORING_OP_OPENAT;
+			open->fd           = AT_FDCWD;
+			open->addr         = reinterpret_cast<uint64_t>(paths[next].c_str());
+			open->open_flags   = O_RDONLY | O_CLOEXEC;
+			open->user_data    = next << 2 | OpOpen;
+			inFlight++;
+			next++;
+		}
+
+		if (!ring.submitAndWait()) {
+			// The ring broke: the files it started are read again with blocking calls, the others are left to the blocking reader.
+			// Their buffers may still be the target of a request, they are only freed after the ring.
+			for (size_t index = 0; index < next; index++) {
+				Pending& state = pending[index];
+				if (state.finished) continue;
+				abandoned.push_back(std::move(state.file.data));
+				finishBlocking(index);
+			}
+			return next;
+		}
+
+		io_uring_cqe completion;
+		while (ring.reap(completion)) {
+			inFlight--;
+			const size_t index  = static_cast<size_t>(completion.user_data >> 2);
+			const auto   op     = static_cast<RingOp>(completion.user_data & 3);
+			Pending&     state  = pending[index];
+			const int    result = completion.res;
+
+			if (op == OpHint) continue;		// only a hint, the read that follows tells if the file is readable
+
+			// The kernel refused the request itself, not the file: a filesystem without the operation or a kernel that changed since the probe
+			if (result == -EINVAL || result == -EOPNOTSUPP) {
+				finishBlocking(index);
+				continue;
+			}
+			if (op == OpOpen) {
+				if (result < 0) {
+					finish(index);
+					continue;
+				}
+				state.fd = result;
+				state.file.data.resize(state.file.reserved);
+				if (state.file.reserved == 0) finish(index);
+				else queueRead(index, true);
+				continue;
+			}
+
+			// A read cancelled because its hint failed is tried again without the hint, a short read continues where it stopped
+			if (result == -ECANCELED) queueRead(index, false);
+			else if (result <= 0) finish(index);
+			else {
+				state.done += static_cast<size_t>(result);
+				if (state.done < state.file.reserved) queueRead(index, false);
+				else finish(index);
+			}
+		}
+	}
+	return paths.size();
+}
+
+#endif
+
+}
+
+void readFiles(const std::vector<std::string>& paths, const std::vector<uintmax_t>& sizes, const unsigned int threads,
+               const std::function<void(size_t, const std::vector<uint8_t>&)>& consume)
+{
+	ReadQueue queue(paths.size());
+
+	std::thread reader([&]() {
+		TraceScope trace("read files");
+		size_t     first = 0;
+#ifdef __linux__
+		first = readWithRing(paths, sizes, queue);
+#endif
+		if (first < paths.size()) readBlocking(paths, sizes, first, queue);
+	});
+
+	parallelFor(std::max(1u, threads), std::max(1u, threads), [&](size_t) {
+		ReadFile file;
+		while (queue.pop(file)) {
+			consume(file.index, file.data);
+			queue.release(file.reserved);
+			file.data = {};
+		}
+	});
+	reader.join();
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+   Read every file of 'paths' and hand it to consume(index, bytes) on up to 'threads' workers as soon as it is in memory, so the disk
+   and the decoders work at the same time. A file that cannot be read is handed over empty.
+   'sizes' are the sizes found by the scan, they size the buffers and the readahead hint of every file; a file that grew since the
+   scan is cut at that size. Files read and not yet consumed are kept under a budget so the reader never runs far ahead of the workers.
+   On Linux the opens, the hints and the reads of many files are queued at once through io_uring by one I/O thread, which hides the
+   latency of slow or network storage. Elsewhere, or if the kernel refuses io_uring or lacks its file operations, a few I/O threads read
+   with blocking calls.
+*/
+void readFiles(const std::vector<std::string>& paths, const std::vector<uintmax_t>& sizes, unsigned int threads,
+               const std::function<void(size_t, const std::vector<uint8_t>&)>& consume);
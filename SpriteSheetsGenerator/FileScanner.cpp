@@ -0,0 +1,118 @@
+#include "FileScanner.h"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <system_error>
+#include "Parallel.h"
+
+#ifdef __linux__
+#include <sys/stat.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Formats read by sf::Image::loadFromFile
+constexpr std::string_view IMAGE_EXTENSIONS[] = {"bmp", "gif", "hdr", "jpeg", "jpg", "pic", "png", "psd", "tga"};
+
+/* Fill the size and the timestamp of a file, return false if it vanished. */
+bool statFile(const fs::directory_entry& entry, ScannedFile& file)
+{
+#ifdef __linux__
+	// One stat instead of one per attribute
+	struct stat status{};
+	if (stat(entry.path().c_str(), &status) != 0) return false;
+	file.size = static_cast<uintmax_t>(status.st_size);
+	file.time = static_cast<int64_t>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+	return true;
+#else
+	// The attributes come with the entry on Windows, no extra system call
+	std::error_code error;
+	file.size = entry.file_size(error);
+	file.time = static_cast<int64_t>(entry.last_write_time(error).time_since_epoch().count());
+	return !error;
+#endif
+}
+
+/* Add the images of one directory to 'files' and its subdirectories to 'subdirectories'. */
+void readDirectory(const fs::path& folder, const std::string& relative, std::vector<std::string>& subdirectories, std::vector<ScannedFile>& files)
+{
+	std::error_code error;
+	const fs::path  path = relative.empty() ? folder : folder / relative;
+
+	for (fs::directory_iterator it(path, fs::directory_options::skip_permission_denied, error), end; !error && it != end; it.increment(error)) {
+		const std::string name  = it->path().filename().string();
+		std::string       child = relative.empty() ? name : relative + "/" + name;
+
+		// The type comes from the directory listing, so only the images cost a stat
+		if (it->is_directory(error)) {
+			if (!it->is_symlink(error)) subdirectories.push_back(std::move(child));
+			continue;
+		}
+		if (!isImageFile(name) || !it->is_regular_file(error)) continue;
+
+		ScannedFile file;
+		file.path = std::move(child);
+		if (statFile(*it, file)) files.push_back(std::move(file));
+	}
+}
+
+}
+
+bool isImageFile(const std::string_view path)
+{
+	const size_t dot = path.rfind('.');
+	if (dot == std::string_view::npos) return false;
+
+	const std::string_view extension = path.substr(dot + 1);
+	return std::any_of(std::begin(IMAGE_EXTENSIONS), std::end(IMAGE_EXTENSIONS), [extension](const std::string_view known) {
+		return std::equal(extension.begin(), extension.end(), known.begin(), known.end(), [](const char a, const char b) {
+			return std::tolower(static_cast<unsigned char>(a)) == b;
+		});
+	});
+}
+
+std::vector<ScannedFile> scanImages(const std::string& folder, const unsigned int threads)
+{
+	const fs::path root    = folder;
+	const size_t   workers = std::max(1u, threads);
+
+	std::mutex                            mutex;
+	std::condition_variable               wake;
+	std::vector<std::string>              pending{""};	// directories left to read, the root is ""
+	size_t                                reading = 0;	// directories being read right now
+	std::vector<std::vector<ScannedFile>> found(workers);
+
+	// Every worker reads directories until none is left and no other worker can find more
+	parallelFor(workers, static_cast<unsigned int>(workers), [&](const size_t worker) {
+		std::vector<std::string>     subdirectories;
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while (true) {
+			wake.wait(lock, [&]() { return !pending.empty() || reading == 0; });
+			if (pending.empty()) return;
+
+			const std::string directory = std::move(pending.back());
+			pending.pop_back();
+			reading++;
+
+			lock.unlock();
+			readDirectory(root, directory, subdirectories, found[worker]);
+			lock.lock();
+
+			reading--;
+			for (auto& subdirectory : subdirectories) pending.push_back(std::move(subdirectory));
+			subdirectories.clear();
+			wake.notify_all();
+		}
+	});
+
+	std::vector<ScannedFile> files;
+	for (auto& part : found) std::move(part.begin(), part.end(), std::back_inserter(files));
+	std::sort(files.begin(), files.end(), [](const ScannedFile& a, const ScannedFile& b) { return a.path < b.path; });
+	return files;
+}
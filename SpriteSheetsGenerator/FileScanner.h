@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// An image file found by scanImages
+struct ScannedFile {
+	std::string path;		// relative to the scanned folder, with '/' separators
+	uintmax_t   size = 0;
+	int64_t     time = 0;	// last write time, only meaningful when compared with another scan of the same file
+};
+
+/* True if the extension of 'path' is one of the formats the decoder reads, whatever its case. */
+bool isImageFile(std::string_view path);
+
+/*
+   Every image file of 'folder' and of its subdirectories, sorted by path because the layout depends on the order.
+   Directories are read in parallel on up to 'threads' threads. Symbolic links to directories are not followed.
+*/
+std::vector<ScannedFile> scanImages(const std::string& folder, unsigned int threads);
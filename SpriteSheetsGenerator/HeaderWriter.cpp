@@ -0,0 +1,120 @@
+#include "HeaderWriter.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include "AtomicFile.h"
+
+namespace {
+
+// Keywords that are valid identifiers once sanitized but cannot be used as enumerators
+const std::set<std::string> KEYWORDS = {
+	"alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch", "char", "char8_t",
+	"char16_t", "char32_t", "class", "compl", "concept", "const", "consteval", "constexpr", "constinit", "const_cast", "continue",
+	"co_await", "co_return", "co_yield", "decltype", "default", "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit",
+	"export", "extern", "false", "float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new",
+	"noexcept", "not", "not_eq", "nullptr", "operator", "or", "or_eq", "private", "protected", "public", "register",
+	"reinterpret_cast", "requires", "return", "short", "signed", "sizeof", "static", "static_assert", "static_cast", "struct",
+	"switch", "template", "this", "thread_local", "throw", "true", "try", "typedef", "typeid", "typename", "union", "unsigned",
+	"using", "virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq", "Count"
+};
+
+/* Read the whole file, empty if it does not exist. */
+std::string readFile(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+/* A name that fits on one line of comment, a backslash at the end of a line would continue the comment. */
+std::string toComment(const std::string_view text)
+{
+	std::string name(text);
+	std::replace_if(name.begin(), name.end(), [](const char c) { return c == '\n' || c == '\r' || c == '\\'; }, ' ');
+	return name;
+}
+
+}
+
+std::string toIdentifier(const std::string_view name)
+{
+	// Runs of invalid characters become one underscore, double underscores are reserved
+	std::string identifier;
+	for (const char c : name) {
+		const bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+		if (valid) identifier += c;
+		else if (identifier.empty() || identifier.back() != '_') identifier += '_';
+	}
+
+	// Identifiers cannot start with a digit, and names starting with an underscore and a capital are reserved
+	if (identifier.empty() || (identifier[0] >= '0' && identifier[0] <= '9')) identifier = "Sprite_" + identifier;
+	else if (identifier[0] == '_') identifier = "Sprite" + identifier;
+	if (KEYWORDS.count(identifier)) identifier += '_';
+	return identifier;
+}
+
+bool writeSpriteHeader(const std::string& path, const SpriteCatalog& sprites)
+{
+	const std::string& sheetName = sprites.getFilename();
+
+	// Names that collide once sanitized get a numeric suffix
+	std::vector<std::string> identifiers;
+	std::set<std::string>    used;
+	for (uint32_t i = 0; i < sprites.size(); i++) {
+		const std::string base       = toIdentifier(sprites.getName(i));
+		std::string       identifier = base;
+		for (int suffix = 2; used.count(identifier); suffix++) identifier = base + "_" + std::to_string(suffix);
+		used.insert(identifier);
+		identifiers.push_back(identifier);
+	}
+
+	std::ostringstream out;
+	out << "// Generated by SpriteSheetsGenerator from " << toComment(sheetName) << ", do not edit.\n"
+		<< "#pragma once\n\n"
+		<< "#include <cstddef>\n"
+		<< "#include <cstdint>\n\n"
+		<< "namespace " << toIdentifier(sheetName.substr(0, sheetName.find('.'))) << " {\n\n"
+		<< "enum class SpriteId : uint32_t {\n";
+	for (uint32_t i = 0; i < sprites.size(); i++) {
+		out << "\t" << identifiers[i] << ",\t// " << toComment(sprites.getName(i)) << "\n";
+	}
+	out << "\tCount\n"
+		<< "};\n\n"
+		<< "struct SpriteRect {\n"
+		<< "\tuint16_t x;\n"
+		<< "\tuint16_t y;\n"
+		<< "\tuint16_t w;\n"
+		<< "\tuint16_t h;\n"
+		<< "\tuint16_t page;\n"
+		<< "\tuint16_t rotation;\n"
+		<< "\tuint16_t channel;\t// 0 for whole pixels, 1 to 4 for a mask in the red to alpha channel\n"
+		<< "};\n\n"
+		<< "inline constexpr SpriteRect SPRITES[] = {\n";
+	for (uint32_t i = 0; i < sprites.size(); i++) {
+		out << "\t{" << sprites.getX(i) << ", " << sprites.getY(i) << ", " << sprites.getWidth(i) << ", " << sprites.getHeight(i) << ", " << sprites.getPage(i) << ", " << sprites.getRotation(i) << ", " << sprites.getChannel(i) << "},\n";
+	}
+	if (sprites.empty()) out << "\t{0, 0, 0, 0, 0, 0, 0},\n";	// arrays cannot be empty
+	out << "};\n\n"
+		<< "inline constexpr size_t SPRITE_COUNT = static_cast<size_t>(SpriteId::Count);\n\n"
+		<< "constexpr const SpriteRect& sprite(const SpriteId id)\n"
+		<< "{\n"
+		<< "\treturn SPRITES[static_cast<uint32_t>(id)];\n"
+		<< "}\n\n"
+		<< "}\n";
+
+	// Keep the timestamp of the header when nothing changed
+	const std::string content = out.str();
+	if (readFile(path) == content) return true;
+
+	const std::string temporary = temporaryPath(path);
+	std::ofstream     file(temporary, std::ios::binary | std::ios::trunc);
+	file << content;
+	file.close();
+	if (!file) {
+		discardFile(temporary);
+		return false;
+	}
+	return commitFile(temporary, path);
+}
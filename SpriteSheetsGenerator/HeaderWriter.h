@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "SpriteCatalog.h"
+
+/* Turn a sprite or sheet name into a valid C++ identifier: 'Agahnim'sShadow' gives 'Agahnim_sShadow', 'Mr.Write' gives 'Mr_Write'. */
+std::string toIdentifier(std::string_view name);
+
+/*
+   Write a C++ header with an 'enum class SpriteId' and a constexpr table of the sprite rectangles, in a namespace named after the sheet.
+   The file is only rewritten when its content changes so that the game does not recompile after every build of the sheet.
+   Return false if the file cannot be written.
+*/
+bool writeSpriteHeader(const std::string& path, const SpriteCatalog& sprites);
@@ -19,11 +19,15 @@ namespace rbp
 {
 	using namespace std;
 
-	MaxRectsBinPack::MaxRectsBinPack()
+	MaxRectsBinPack::MaxRectsBinPack(std::pmr::memory_resource *resource)
 		: binWidth(0),
-		  binHeight(0) {}
+		  binHeight(0),
+		  usedRectangles(resource),
+		  freeRectangles(resource) {}
 
-	MaxRectsBinPack::MaxRectsBinPack(const int width, const int height)
+	MaxRectsBinPack::MaxRectsBinPack(const int width, const int height, std::pmr::memory_resource *resource)
+		: usedRectangles(resource),
+		  freeRectangles(resource)
 	{
 		init(width, height);
 	}
@@ -43,24 +47,29 @@ namespace rbp
 
 		freeRectangles.clear();
 		freeRectangles.push_back(n);
+		pack_stats(packStats.freeRectsHighWater = max<uint64_t>(packStats.freeRectsHighWater, 1));
 	}
 
-	Rect MaxRectsBinPack::insert(const int width, const int height, const FreeRectChoiceHeuristic method)
+	Rect MaxRectsBinPack::insert(const int width, const int height, const FreeRectChoiceHeuristic method, const bool allowFlip)
 	{
+		pack_stats(PackTimer timer(packStats.insertNanoseconds));
+		pack_stats(packStats.scores++);
+		pack_stats(packStats.scoredFreeRects += freeRectangles.size());
+
 		Rect newNode = {};
 		// Unused in this function. We don't need to know the score after finding the position.
 		int score1 = std::numeric_limits<int>::max();
 		int score2 = std::numeric_limits<int>::max();
 		switch (method) {
-			case RectBestShortSideFit: newNode = findPositionForNewNodeBestShortSideFit(width, height, score1, score2);
+			case RectBestShortSideFit: newNode = findPositionForNewNodeBestShortSideFit(width, height, score1, score2, allowFlip);
 				break;
-			case RectBottomLeftRule: newNode = findPositionForNewNodeBottomLeft(width, height, score1, score2);
+			case RectBottomLeftRule: newNode = findPositionForNewNodeBottomLeft(width, height, score1, score2, allowFlip);
 				break;
-			case RectContactPointRule: newNode = findPositionForNewNodeContactPoint(width, height, score1);
+			case RectContactPointRule: newNode = findPositionForNewNodeContactPoint(width, height, score1, allowFlip);
 				break;
-			case RectBestLongSideFit: newNode = findPositionForNewNodeBestLongSideFit(width, height, score2, score1);
+			case RectBestLongSideFit: newNode = findPositionForNewNodeBestLongSideFit(width, height, score2, score1, allowFlip);
 				break;
-			case RectBestAreaFit: newNode = findPositionForNewNodeBestAreaFit(width, height, score1, score2);
+			case RectBestAreaFit: newNode = findPositionForNewNodeBestAreaFit(width, height, score1, score2, allowFlip);
 				break;
 		}
 
@@ -74,15 +83,18 @@ namespace rbp
 				--numRectanglesToProcess;
 			}
 		}
+		pack_stats(packStats.freeRectsHighWater = max<uint64_t>(packStats.freeRectsHighWater, freeRectangles.size()));
 
 		pruneFreeList();
 
 		usedRectangles.push_back(newNode);
+		pack_stats(packStats.inserts++);
 		return newNode;
 	}
 
 	void MaxRectsBinPack::insert(std::vector<RectSize>& rects, std::vector<Rect>& dst, const FreeRectChoiceHeuristic method)
 	{
+		pack_stats(PackTimer timer(packStats.insertNanoseconds));
 		dst.clear();
 
 		while (!rects.empty()) {
@@ -95,6 +107,8 @@ namespace rbp
 				int        score1;
 				int        score2;
 				const Rect newNode = scoreRect(rects[i].width, rects[i].height, method, score1, score2);
+				pack_stats(packStats.scores++);
+				pack_stats(packStats.scoredFreeRects += freeRectangles.size());
 
 				if (score1 < bestScore1 || (score1 == bestScore1 && score2 < bestScore2)) {
 					bestScore1    = score1;
@@ -121,29 +135,31 @@ namespace rbp
 				--numRectanglesToProcess;
 			}
 		}
+		pack_stats(packStats.freeRectsHighWater = max<uint64_t>(packStats.freeRectsHighWater, freeRectangles.size()));
 
 		pruneFreeList();
 
 		usedRectangles.push_back(node);
+		pack_stats(packStats.inserts++);
 		//		dst.push_back(bestNode); ///\todo Refactor so that this compiles.
 	}
 
-	Rect MaxRectsBinPack::scoreRect(const int width, const int height, const FreeRectChoiceHeuristic method, int& score1, int& score2) const
+	Rect MaxRectsBinPack::scoreRect(const int width, const int height, const FreeRectChoiceHeuristic method, int& score1, int& score2, const bool allowFlip) const
 	{
 		Rect newNode = {};
 		score1       = std::numeric_limits<int>::max();
 		score2       = std::numeric_limits<int>::max();
 		switch (method) {
-			case RectBestShortSideFit: newNode = findPositionForNewNodeBestShortSideFit(width, height, score1, score2);
+			case RectBestShortSideFit: newNode = findPositionForNewNodeBestShortSideFit(width, height, score1, score2, allowFlip);
 				break;
-			case RectBottomLeftRule: newNode = findPositionForNewNodeBottomLeft(width, height, score1, score2);
+			case RectBottomLeftRule: newNode = findPositionForNewNodeBottomLeft(width, height, score1, score2, allowFlip);
 				break;
-			case RectContactPointRule: newNode = findPositionForNewNodeContactPoint(width, height, score1);
+			case RectContactPointRule: newNode = findPositionForNewNodeContactPoint(width, height, score1, allowFlip);
 				score1 = -score1; // Reverse since we are minimizing, but for contact point score bigger is better.
 				break;
-			case RectBestLongSideFit: newNode = findPositionForNewNodeBestLongSideFit(width, height, score2, score1);
+			case RectBestLongSideFit: newNode = findPositionForNewNodeBestLongSideFit(width, height, score2, score1, allowFlip);
 				break;
-			case RectBestAreaFit: newNode = findPositionForNewNodeBestAreaFit(width, height, score1, score2);
+			case RectBestAreaFit: newNode = findPositionForNewNodeBestAreaFit(width, height, score1, score2, allowFlip);
 				break;
 		}
 
@@ -165,7 +181,7 @@ namespace rbp
 		return static_cast<float>(usedSurfaceArea) / static_cast<float>(binWidth * binHeight);
 	}
 
-	Rect MaxRectsBinPack::findPositionForNewNodeBottomLeft(const int width, const int height, int& bestY, int& bestX) const
+	Rect MaxRectsBinPack::findPositionForNewNodeBottomLeft(const int width, const int height, int& bestY, int& bestX, const bool allowFlip) const
 	{
 		Rect bestNode = {};
 
@@ -185,7 +201,7 @@ namespace rbp
 					bestX           = freeRect.x;
 				}
 			}
-			if (freeRect.width >= height && freeRect.height >= width) {
+			if (allowFlip && freeRect.width >= height && freeRect.height >= width) {
 				const int topSideY = freeRect.y + width;
 				if (topSideY < bestY || (topSideY == bestY && freeRect.x < bestX)) {
 					bestNode.x      = freeRect.x;
@@ -203,7 +219,8 @@ namespace rbp
 	Rect MaxRectsBinPack::findPositionForNewNodeBestShortSideFit(const int width,
 																 const int height,
 																 int&      bestShortSideFit,
-																 int&      bestLongSideFit) const
+																 int&      bestLongSideFit,
+																 const bool allowFlip) const
 	{
 		Rect bestNode = {};
 
@@ -228,7 +245,7 @@ namespace rbp
 				}
 			}
 
-			if (freeRect.width >= height && freeRect.height >= width) {
+			if (allowFlip && freeRect.width >= height && freeRect.height >= width) {
 				int       flippedLeftoverHoriz = abs(freeRect.width - height);
 				int       flippedLeftoverVert  = abs(freeRect.height - width);
 				const int flippedShortSideFit  = min(flippedLeftoverHoriz, flippedLeftoverVert);
@@ -250,7 +267,8 @@ namespace rbp
 	Rect MaxRectsBinPack::findPositionForNewNodeBestLongSideFit(const int width,
 																const int height,
 																int&      bestShortSideFit,
-																int&      bestLongSideFit) const
+																int&      bestLongSideFit,
+																const bool allowFlip) const
 	{
 		Rect bestNode{};
 
@@ -275,7 +293,7 @@ namespace rbp
 				}
 			}
 
-			if (freeRect.width >= height && freeRect.height >= width) {
+			if (allowFlip && freeRect.width >= height && freeRect.height >= width) {
 				int       leftoverHoriz = abs(freeRect.width - height);
 				int       leftoverVert  = abs(freeRect.height - width);
 				const int shortSideFit  = min(leftoverHoriz, leftoverVert);
@@ -297,7 +315,8 @@ namespace rbp
 	Rect MaxRectsBinPack::findPositionForNewNodeBestAreaFit(const int width,
 															const int height,
 															int&      bestAreaFit,
-															int&      bestShortSideFit) const
+															int&      bestShortSideFit,
+															const bool allowFlip) const
 	{
 		Rect bestNode{};
 
@@ -323,7 +342,7 @@ namespace rbp
 				}
 			}
 
-			if (freeRect.width >= height && freeRect.height >= width) {
+			if (allowFlip && freeRect.width >= height && freeRect.height >= width) {
 				int       leftoverHoriz = abs(freeRect.width - height);
 				int       leftoverVert  = abs(freeRect.height - width);
 				const int shortSideFit  = min(leftoverHoriz, leftoverVert);
@@ -362,7 +381,7 @@ namespace rbp
 		return score;
 	}
 
-	Rect MaxRectsBinPack::findPositionForNewNodeContactPoint(const int width, const int height, int& contactScore) const
+	Rect MaxRectsBinPack::findPositionForNewNodeContactPoint(const int width, const int height, int& contactScore, const bool allowFlip) const
 	{
 		Rect bestNode{};
 
@@ -380,7 +399,7 @@ namespace rbp
 					contactScore    = score;
 				}
 			}
-			if (freeRect.width >= height && freeRect.height >= width) {
+			if (allowFlip && freeRect.width >= height && freeRect.height >= width) {
 				const int score = contactPointScoreNode(freeRect.x, freeRect.y, height, width);
 				if (score > contactScore) {
 					bestNode.x      = freeRect.x;
@@ -396,11 +415,15 @@ namespace rbp
 
 	bool MaxRectsBinPack::splitFreeNode(const Rect freeNode, const Rect& usedNode)
 	{
+		pack_stats(packStats.splitCalls++);
+
 		// Test with SAT if the rectangles even intersect.
 		if (usedNode.x >= freeNode.x + freeNode.width || usedNode.x + usedNode.width <= freeNode.x ||
 			usedNode.y >= freeNode.y + freeNode.height || usedNode.y + usedNode.height <= freeNode.y)
 			return false;
 
+		pack_stats(const size_t freeCount = freeRectangles.size());
+
 		if (usedNode.x < freeNode.x + freeNode.width && usedNode.x + usedNode.width > freeNode.x) {
 			// New node at the top side of the used node.
 			if (usedNode.y > freeNode.y && usedNode.y < freeNode.y + freeNode.height) {
@@ -435,6 +458,7 @@ namespace rbp
 			}
 		}
 
+		pack_stats(packStats.splitRects += freeRectangles.size() - freeCount);
 		return true;
 	}
 
@@ -462,12 +486,16 @@ namespace rbp
 		/// Go through each pair and remove any rectangle that is redundant.
 		for (size_t i = 0; i < freeRectangles.size(); ++i)
 			for (size_t j = i + 1; j < freeRectangles.size(); ++j) {
+				pack_stats(packStats.pruneTests++);
 				if (isContainedIn(freeRectangles[i], freeRectangles[j])) {
+					pack_stats(packStats.pruneRemovals++);
 					freeRectangles.erase(freeRectangles.begin() + i);
 					--i;
 					break;
 				}
+				pack_stats(packStats.pruneTests++);
 				if (isContainedIn(freeRectangles[j], freeRectangles[i])) {
+					pack_stats(packStats.pruneRemovals++);
 					freeRectangles.erase(freeRectangles.begin() + j);
 					--j;
 				}
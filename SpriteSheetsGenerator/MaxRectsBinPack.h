@@ -7,6 +7,7 @@
 */
 #pragma once
 
+#include <memory_resource>
 #include <vector>
 
 #include "Rect.h"
@@ -19,10 +20,12 @@ class MaxRectsBinPack
 {
 public:
 	/// Instantiates a bin of size (0,0). Call Init to create a new bin.
-	MaxRectsBinPack();
+	/// @param resource Allocates the rectangle lists, it must outlive the packer. A monotonic buffer makes a
+	///	throwaway trial pack free of heap allocations.
+	explicit MaxRectsBinPack(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
 
 	/// Instantiates a bin of the given size.
-	MaxRectsBinPack(int width, int height);
+	MaxRectsBinPack(int width, int height, std::pmr::memory_resource *resource = std::pmr::get_default_resource());
 
 	/// (Re)initializes the packer to an empty bin of width x height units. Call whenever
 	/// you need to restart with a new bin.
@@ -45,23 +48,33 @@ public:
 	void insert(std::vector<RectSize> &rects, std::vector<Rect> &dst, FreeRectChoiceHeuristic method);
 
 	/// Inserts a single rectangle into the bin, possibly rotated.
-	Rect insert(int width, int height, FreeRectChoiceHeuristic method);
+	/// @param allowFlip If false, the rectangle is only tried in its upright orientation.
+	Rect insert(int width, int height, FreeRectChoiceHeuristic method, bool allowFlip = true);
 
 	/// Computes the ratio of used surface area to the total bin area.
 	float occupancy() const;
 
+#ifdef RBP_PACK_STATS
+	/// The work done since the packer was constructed, init does not reset it.
+	const PackStats &stats() const { return packStats; }
+#endif
+
 private:
 	int binWidth{};
 	int binHeight{};
 
-	std::vector<Rect> usedRectangles;
-	std::vector<Rect> freeRectangles;
+	std::pmr::vector<Rect> usedRectangles;
+	std::pmr::vector<Rect> freeRectangles;
+
+#ifdef RBP_PACK_STATS
+	PackStats packStats;
+#endif
 
 	/// Computes the placement score for placing the given rectangle with the given method.
 	/// @param score1 [out] The primary placement score will be outputted here.
 	/// @param score2 [out] The secondary placement score will be outputted here. This isu sed to break ties.
 	/// @return This struct identifies where the rectangle would be placed if it were placed.
-	Rect scoreRect(int width, int height, FreeRectChoiceHeuristic method, int &score1, int &score2) const;
+	Rect scoreRect(int width, int height, FreeRectChoiceHeuristic method, int &score1, int &score2, bool allowFlip = true) const;
 
 	/// Places the given rectangle into the bin.
 	void placeRect(const Rect &node);
@@ -69,11 +82,11 @@ private:
 	/// Computes the placement score for the -CP variant.
 	int contactPointScoreNode(int x, int y, int width, int height) const;
 
-	Rect findPositionForNewNodeBottomLeft(int width, int height, int &bestY, int &bestX) const;
-	Rect findPositionForNewNodeBestShortSideFit(int width, int height, int &bestShortSideFit, int &bestLongSideFit) const;
-	Rect findPositionForNewNodeBestLongSideFit(int width, int height, int &bestShortSideFit, int &bestLongSideFit) const;
-	Rect findPositionForNewNodeBestAreaFit(int width, int height, int &bestAreaFit, int &bestShortSideFit) const;
-	Rect findPositionForNewNodeContactPoint(int width, int height, int &contactScore) const;
+	Rect findPositionForNewNodeBottomLeft(int width, int height, int &bestY, int &bestX, bool allowFlip) const;
+	Rect findPositionForNewNodeBestShortSideFit(int width, int height, int &bestShortSideFit, int &bestLongSideFit, bool allowFlip) const;
+	Rect findPositionForNewNodeBestLongSideFit(int width, int height, int &bestShortSideFit, int &bestLongSideFit, bool allowFlip) const;
+	Rect findPositionForNewNodeBestAreaFit(int width, int height, int &bestAreaFit, int &bestShortSideFit, bool allowFlip) const;
+	Rect findPositionForNewNodeContactPoint(int width, int height, int &contactScore, bool allowFlip) const;
 
 	/// @return True if the free node was split.
 	bool splitFreeNode(Rect freeNode, const Rect &usedNode);
@@ -0,0 +1,134 @@
+#include "Mipmaps.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "Parallel.h"
+
+namespace {
+
+// Resolution of the linear to sRGB table, fine enough to give back every 8-bit value
+constexpr int LINEAR_STEPS = 4096;
+
+struct TransferTables {
+	float   toLinear[256];
+	uint8_t toSrgb[LINEAR_STEPS + 1];
+};
+
+const TransferTables& transferTables()
+{
+	static const TransferTables tables = [] {
+		TransferTables t{};
+		for (int i = 0; i < 256; i++) {
+			const float c = i / 255.0f;
+			t.toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		for (int i = 0; i <= LINEAR_STEPS; i++) {
+			const float l = static_cast<float>(i) / LINEAR_STEPS;
+			const float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+			t.toSrgb[i]   = static_cast<uint8_t>(std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f));
+		}
+		return t;
+	}();
+	return tables;
+}
+
+// The source pixels under one target pixel along an axis, with integer weights that sum to 'total'
+struct Taps {
+	uint32_t index[3];
+	uint32_t weight[3];
+	uint32_t count;
+	uint32_t total;
+};
+
+/* Taps of the target pixel 't' along an axis of 'sourceSize' pixels, see downsample for the weights. */
+Taps axisTaps(const uint32_t sourceSize, const uint32_t t)
+{
+	if (sourceSize == 1) return {{0, 0, 0}, {1, 0, 0}, 1, 1};
+	if (sourceSize % 2 == 0) return {{2 * t, 2 * t + 1, 0}, {1, 1, 0}, 2, 2};
+
+	// 2m+1 source pixels over m target pixels: target t covers the part m-t of the pixel 2t, all of 2t+1 and t+1 of 2t+2
+	const uint32_t m = sourceSize / 2;
+	return {{2 * t, 2 * t + 1, 2 * t + 2}, {m - t, m, t + 1}, 3, sourceSize};
+}
+
+}
+
+uint32_t mipLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t levels = 1;
+	while (width > 1 || height > 1) {
+		width  = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+		levels++;
+	}
+	return levels;
+}
+
+void downsample(const PixelBuffer& source, PixelBuffer& target, const MipContent content, const unsigned int threads)
+{
+	const TransferTables& tables = transferTables();
+
+	// The taps of the columns are the same for every row
+	std::vector<Taps> columnTaps(target.width());
+	for (uint32_t tx = 0; tx < target.width(); tx++) {
+		columnTaps[tx] = axisTaps(source.width(), tx);
+		for (uint32_t i = 0; i < columnTaps[tx].count; i++) columnTaps[tx].index[i] *= 4;
+	}
+
+	parallelFor(target.height(), threads, [&](const size_t ty) {
+		const Taps     rowTaps = axisTaps(source.height(), static_cast<uint32_t>(ty));
+		const uint8_t* rows[3] = {};
+		for (uint32_t j = 0; j < rowTaps.count; j++) rows[j] = source.row(rowTaps.index[j]);
+		uint8_t* out = target.row(static_cast<uint32_t>(ty));
+
+		for (uint32_t tx = 0; tx < target.width(); tx++) {
+			const Taps&    columns = columnTaps[tx];
+			const uint64_t total   = static_cast<uint64_t>(rowTaps.total) * columns.total;
+
+			if (content == MipContent::Data) {
+				for (int c = 0; c < 4; c++) {
+					uint64_t sum = 0;
+					for (uint32_t j = 0; j < rowTaps.count; j++) {
+						for (uint32_t i = 0; i < columns.count; i++) sum += uint64_t(rows[j][columns.index[i] + c]) * rowTaps.weight[j] * columns.weight[i];
+					}
+					out[tx * 4 + c] = static_cast<uint8_t>((sum + total / 2) / total);
+				}
+				continue;
+			}
+
+			float    color[3] = {0.0f, 0.0f, 0.0f};
+			float    weight   = 0.0f;
+			uint64_t alpha    = 0;
+			for (uint32_t j = 0; j < rowTaps.count; j++) {
+				for (uint32_t i = 0; i < columns.count; i++) {
+					const uint8_t* pixel    = rows[j] + columns.index[i];
+					const uint64_t coverage = uint64_t(rowTaps.weight[j]) * columns.weight[i];
+					const float    w        = static_cast<float>(coverage) * (content == MipContent::Premultiplied ? 1.0f : pixel[3]);
+					color[0] += tables.toLinear[pixel[0]] * w;
+					color[1] += tables.toLinear[pixel[1]] * w;
+					color[2] += tables.toLinear[pixel[2]] * w;
+					weight   += w;
+					alpha    += pixel[3] * coverage;
+				}
+			}
+
+			// Transparent pixels of straight alpha still get their plain average, for the levels below
+			if (weight == 0.0f) {
+				color[0] = color[1] = color[2] = 0.0f;
+				for (uint32_t j = 0; j < rowTaps.count; j++) {
+					for (uint32_t i = 0; i < columns.count; i++) {
+						const float coverage = static_cast<float>(uint64_t(rowTaps.weight[j]) * columns.weight[i]);
+						for (int c = 0; c < 3; c++) color[c] += tables.toLinear[rows[j][columns.index[i] + c]] * coverage;
+					}
+				}
+				weight = static_cast<float>(total);
+			}
+
+			for (int c = 0; c < 3; c++) {
+				out[tx * 4 + c] = tables.toSrgb[std::min<long>(LINEAR_STEPS, std::lround(color[c] / weight * LINEAR_STEPS))];
+			}
+			out[tx * 4 + 3] = static_cast<uint8_t>((alpha + total / 2) / total);
+		}
+	});
+}
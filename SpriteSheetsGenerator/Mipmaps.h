@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include "PixelPool.h"
+
+// What the channels of a page hold, for the filtering of its mip levels
+enum class MipContent {
+	Straight,			// sRGB colors and straight alpha
+	Premultiplied,		// sRGB colors multiplied by the alpha
+	Data				// four independent channels averaged as they are, like the masks of a channel packed page
+};
+
+/* Number of levels of the full mip chain of a width x height image, the base level included: 512x256 has 10. */
+uint32_t mipLevelCount(uint32_t width, uint32_t height);
+
+/*
+   Write into 'target' the next mip level of 'source', half its size rounded down and at least 1x1, with a box filter: along an
+   axis of even size each target pixel averages two source pixels, along an axis of odd size it covers a bit more than two so
+   it weights three by the part of each it covers, and the last row or column is not dropped. Colors are averaged in linear light rather than on the sRGB values, which would darken the small levels. Straight alpha
+   colors are weighted by their alpha so that transparent pixels do not bleed into the edges, premultiplied ones already are.
+   The rows are split between 'threads' workers.
+*/
+void downsample(const PixelBuffer& source, PixelBuffer& target, MipContent content, unsigned int threads);
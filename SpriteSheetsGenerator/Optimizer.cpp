@@ -0,0 +1,194 @@
+#include "Optimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <optional>
+#include <random>
+#include "Parallel.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Layouts evaluated by every chain between two checks of the budget
+constexpr unsigned int EPOCH_ITERATIONS = 32;
+
+// 2^(-i/64) for i in [0, 64] in 32.32 fixed point, built by repeated products so that no libm function is involved
+constexpr std::array<uint64_t, 65> EXP2_STEPS = [] {
+	constexpr uint64_t       STEP = 0xfd3e0c0d;		// 2^(-1/64)
+	std::array<uint64_t, 65> steps{};
+	steps[0] = uint64_t(1) << 32;
+	for (size_t i = 1; i < steps.size(); i++) steps[i] = steps[i - 1] * STEP >> 32;
+	return steps;
+}();
+
+// State of one annealing chain
+struct Chain {
+	std::mt19937_64       rng;
+	std::vector<uint32_t> order;
+	std::vector<char>     allowFlip;
+	Layout                current;
+	double                currentCost = 0;
+	Layout                best;
+	double                bestCost = 0;
+	PackArena             arena;			// packers of the candidate layouts
+#ifdef RBP_PACK_STATS
+	rbp::PackStats        searchStats;		// work of every layout packed by the chain
+#endif
+};
+
+// The std distributions are implementation defined, draw from the engine directly to get the same numbers on every platform
+size_t randomIndex(std::mt19937_64& rng, const size_t count)
+{
+	return static_cast<size_t>(rng() % count);
+}
+
+double randomUnit(std::mt19937_64& rng)
+{
+	return static_cast<double>(rng() >> 11) * 0x1.0p-53;
+}
+
+/*
+   Probability exp(-excess) of accepting a worse layout, in 0.32 fixed point. std::exp is not correctly rounded and its result
+   differs between libm versions, so it is computed as a power of 2 from EXP2_STEPS with integer arithmetic only.
+*/
+uint64_t acceptance(const double excess)
+{
+	if (!(excess < 32.0)) return 0;		// also rejects NaN and infinities
+
+	const uint64_t exponent = static_cast<uint64_t>(excess * 94548.4621996991);		// excess * log2(e) with 16 fraction bits
+	const uint64_t whole    = exponent >> 16;
+	if (whole >= 32) return 0;
+
+	// The fraction picks a 64th of the table, the last 10 bits interpolate linearly between two steps
+	const uint64_t index  = (exponent >> 10) & 63;
+	const uint64_t weight = exponent & 1023;
+	const uint64_t scaled = EXP2_STEPS[index] - ((EXP2_STEPS[index] - EXP2_STEPS[index + 1]) * weight >> 10);
+	return scaled >> whole;
+}
+
+void runEpoch(const std::vector<rbp::RectSize>& sizes,
+			  const rbp::MaxRectsBinPack::FreeRectChoiceHeuristic heuristic,
+			  const int binWidth, const int binHeight,
+			  const unsigned int iterations,
+			  const double temperature,
+			  const std::optional<Clock::time_point>& deadline,
+			  Chain& chain)
+{
+	const size_t count = sizes.size();
+
+	for (unsigned int iteration = 0; iteration < iterations; iteration++) {
+		if (deadline && Clock::now() >= *deadline) break;
+
+		// Mutate: swap two images, move one image, or toggle the rotation allowance of one image
+		std::vector<uint32_t> order     = chain.order;
+		std::vector<char>     allowFlip = chain.allowFlip;
+		const double          move      = randomUnit(chain.rng);
+		const size_t          a         = randomIndex(chain.rng, count);
+		const size_t          b         = randomIndex(chain.rng, count);
+
+		if (move < 0.6) {
+			std::swap(order[a], order[b]);
+		}
+		else if (move < 0.85) {
+			if (a < b) std::rotate(order.begin() + static_cast<long>(a), order.begin() + static_cast<long>(a) + 1, order.begin() + static_cast<long>(b) + 1);
+			else std::rotate(order.begin() + static_cast<long>(b), order.begin() + static_cast<long>(a), order.begin() + static_cast<long>(a) + 1);
+		}
+		else {
+			allowFlip[a] = allowFlip[a] ? 0 : 1;
+		}
+
+		chain.arena.rewind();
+		Layout       candidate     = packLayout(sizes, order, allowFlip, heuristic, binWidth, binHeight, chain.arena.resource());
+		const double candidateCost = layoutCost(candidate, binWidth, binHeight);
+		const double delta         = candidateCost - chain.currentCost;
+#ifdef RBP_PACK_STATS
+		chain.searchStats += candidate.stats;
+#endif
+
+		if (delta <= 0 || (chain.rng() >> 32) < acceptance(delta / temperature)) {
+			chain.order       = std::move(order);
+			chain.allowFlip   = std::move(allowFlip);
+			chain.current     = std::move(candidate);
+			chain.currentCost = candidateCost;
+
+			if (chain.currentCost < chain.bestCost) {
+				chain.best     = chain.current;
+				chain.bestCost = chain.currentCost;
+			}
+		}
+	}
+}
+
+}
+
+Layout optimizeLayout(const std::vector<rbp::RectSize>& sizes,
+					  const Layout& initial,
+					  const int binWidth, const int binHeight,
+					  const OptimizerSettings& settings)
+{
+	if ((settings.budgetMs == 0 && settings.iterations == 0) || sizes.size() < 2) return initial;
+
+	const auto                       start = Clock::now();
+	std::optional<Clock::time_point> deadline;
+	if (settings.budgetMs > 0) deadline = start + std::chrono::milliseconds(settings.budgetMs);
+
+	// Even chains start from the input order, odd chains from the images sorted by decreasing area
+	std::vector<uint32_t> byArea = identityOrder(sizes.size());
+	std::stable_sort(byArea.begin(), byArea.end(), [&sizes](const uint32_t a, const uint32_t b) {
+		return static_cast<int64_t>(sizes[a].width) * sizes[a].height > static_cast<int64_t>(sizes[b].width) * sizes[b].height;
+	});
+
+	std::vector<Chain> chains(std::max(1u, settings.chains));
+	parallelFor(chains.size(), settings.threads, [&](const size_t i) {
+		Chain& chain      = chains[i];
+		chain.rng.seed(settings.seed + i);
+		chain.order       = i % 2 == 0 ? identityOrder(sizes.size()) : byArea;
+		chain.allowFlip   = std::vector<char>(sizes.size(), 1);
+		chain.current     = packLayout(sizes, chain.order, chain.allowFlip, initial.heuristic, binWidth, binHeight, chain.arena.resource());
+		chain.currentCost = layoutCost(chain.current, binWidth, binHeight);
+		chain.best        = chain.current;
+		chain.bestCost    = chain.currentCost;
+#ifdef RBP_PACK_STATS
+		chain.searchStats = chain.current.stats;
+#endif
+	});
+
+	// The initial temperature is the mean image area so that moving one image around is often accepted at first
+	double meanArea = 0;
+	for (const auto& size : sizes) meanArea += static_cast<double>(size.width) * size.height;
+	const double startTemperature = std::max(1.0, meanArea / static_cast<double>(sizes.size()));
+
+	// Every chain runs the same number of iterations per epoch, the temperature only changes between epochs
+	unsigned int done = 0;
+	while (true) {
+		double progress = 0;
+		if (settings.iterations > 0) progress = static_cast<double>(done) / settings.iterations;
+		if (deadline) progress = std::max(progress, std::chrono::duration<double>(Clock::now() - start).count() * 1000.0 / settings.budgetMs);
+		if (progress >= 1.0) break;
+
+		const unsigned int iterations  = settings.iterations > 0 ? std::min(EPOCH_ITERATIONS, settings.iterations - done) : EPOCH_ITERATIONS;
+		const double       temperature = startTemperature * (1.0 - progress) + 1e-9;
+
+		parallelFor(chains.size(), settings.threads, [&](const size_t i) {
+			runEpoch(sizes, initial.heuristic, binWidth, binHeight, iterations, temperature, deadline, chains[i]);
+		});
+		done += iterations;
+	}
+
+	// Keep the initial layout unless a chain did strictly better, ties go to the lowest chain index
+	Layout best     = initial;
+	double bestCost = layoutCost(initial, binWidth, binHeight);
+	for (const auto& chain : chains) {
+		if (chain.bestCost < bestCost) {
+			best     = chain.best;
+			bestCost = chain.bestCost;
+		}
+	}
+#ifdef RBP_PACK_STATS
+	best.searchStats = initial.searchStats;
+	for (const auto& chain : chains) best.searchStats += chain.searchStats;
+#endif
+	return best;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Packer.h"
+
+// Settings of the anytime layout optimizer
+struct OptimizerSettings {
+	unsigned int budgetMs   = 0;		// wall-clock budget, 0 for no time limit
+	unsigned int iterations = 0;		// layouts evaluated by every chain, 0 for no limit
+	unsigned int chains     = 8;		// number of independent annealing chains, does not depend on the threads
+	unsigned int threads    = 1;		// threads the chains are spread on
+	uint64_t     seed       = 0x5EED;	// base seed, chain i uses seed + i
+};
+
+/*
+   Simulated annealing over the insertion order and the rotation allowance of every image, with packLayout as the evaluator.
+   Every chain starts from 'initial' and the best layout found by any chain when the budget expires is returned, the result is never worse than 'initial'.
+   The optimizer is disabled when both the time budget and the iterations are 0.
+
+   With an iteration budget only, the result depends on the seed and the number of chains but not on the number of threads or the machine.
+   A time budget stops after however many iterations the machine could run, so it is not reproducible.
+*/
+Layout optimizeLayout(const std::vector<rbp::RectSize>& sizes,
+					  const Layout& initial,
+					  int binWidth, int binHeight,
+					  const OptimizerSettings& settings);
@@ -0,0 +1,266 @@
+#include "Options.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+void printUsage(const char* program, std::ostream& log)
+{
+	log << "Usage: " << program << " [options]\n"
+	    << "  --input <folder>            folder of the images (default images)\n"
+	    << "  --output <folder>           folder of the sheet (default sheets)\n"
+	    << "  --name <name>               filename of the sheet (default sheet)\n"
+	    << "  --page-size <w>x<h>         size of a page of the sheet, at most 65535x65535 (default 512x512)\n"
+	    << "  --padding <n>               transparent pixels between two sprites (default 0)\n"
+	    << "  --extrude <n>               repeat the edge pixels of every sprite <n> times around it (default 0)\n"
+	    << "  --alpha <mode>              straight, bleed (color the transparent pixels like their neighbours) or premultiply\n"
+	    << "  --mipmaps                   also write every mip level of the pages, <name>_mip1.png to the 1x1 level\n"
+	    << "  --mip-isolation <n>         place the sprites on a grid of 2^<n> pixels so they stay apart down to mip level <n>\n"
+	    << "  --png <preset>              deflate of the PNG pages: fast, balanced or small (default balanced)\n"
+	    << "  --texture-format <format>   also write every page as a GPU texture: rgba8, rgba4444, rgb565, rgba5551, bc1, bc3 or etc2\n"
+	    << "  --dither <mode>             rounding to rgba4444, rgb565 and rgba5551: none, ordered or diffusion (default none)\n"
+	    << "  --container <type>          file of the GPU textures: none, dds or ktx2 (default dds with --texture-format, ktx2 for etc2, else none)\n"
+	    << "  --supercompress             deflate the levels of the KTX2 textures\n"
+	    << "  --channel-pack              pack the gray and single color sprites as masks, four layers per page, one per channel\n"
+	    << "                              (not with the texture formats rgb565, rgba5551 and bc1 that lose a layer)\n"
+	    << "  --map <name>=<folder>       also draw the images of <folder> with the layout of the sheet, in <name>_<map>.png\n"
+	    << "                              (normals, emissive...), can be repeated, not with --channel-pack\n"
+	    << "  --optimize-ms <ms>          search for a better layout during <ms> milliseconds (default 0)\n"
+	    << "  --optimize-iterations <n>   search for a better layout during <n> iterations, same output on every machine (default 0)\n"
+	    << "  --threads <n>               number of worker threads (default: every hardware thread)\n"
+	    << "  --pixel-limit-mb <n>        most memory for decoded images and pages (default: no limit)\n"
+	    << "  --verify-determinism        check that 1, 4 and 32 threads write the same files and exit\n"
+	    << "  --benchmark-packing <n>     compare <n> rounds of packing on the heap and on an arena and exit\n"
+	    << "  --format <list>             metadata formats separated by commas: xml, json, csv (default xml)\n"
+	    << "  --header <path>             also write a C++ header with an enum and a constexpr table of the sprites\n"
+	    << "  --binary                    also write <output>/<name>.atlas, see AtlasReader.h\n"
+	    << "  --trace <path>              write the time of every stage of the build as a Chrome trace (chrome://tracing, Perfetto)\n"
+	    << "  --watch                     rebuild the sheet every time a file of the input folder changes, until killed\n"
+	    << "  --serve <socket>            run a build server on a Unix domain socket, until killed\n"
+	    << "  --client <socket> ...       send the options that follow to the build server instead of building here\n"
+	    << "  --help                      display this message\n";
+}
+
+bool parseFormats(const std::string_view text, std::vector<SheetFormat>& formats)
+{
+	formats.clear();
+	size_t start = 0;
+	while (start <= text.size()) {
+		const size_t end = std::min(text.find(',', start), text.size());
+		SheetFormat  format;
+		if (!parseSheetFormat(text.substr(start, end - start), format)) return false;
+		if (std::find(formats.begin(), formats.end(), format) == formats.end()) formats.push_back(format);
+		start = end + 1;
+	}
+	return true;
+}
+
+bool parseUnsigned(const char* text, unsigned int& value)
+{
+	const char* end    = text + std::strlen(text);
+	const auto  result = std::from_chars(text, end, value);
+	return result.ec == std::errc() && result.ptr == end;
+}
+
+bool parseSize(const char* text, unsigned int& width, unsigned int& height)
+{
+	const char* end = text + std::strlen(text);
+	const auto  x   = std::from_chars(text, end, width);
+	if (x.ec != std::errc() || x.ptr == end || (*x.ptr != 'x' && *x.ptr != 'X')) return false;
+
+	const auto y = std::from_chars(x.ptr + 1, end, height);
+	return y.ec == std::errc() && y.ptr == end && width > 0 && height > 0 && width <= 65535 && height <= 65535;
+}
+
+bool parseMap(const std::string_view text, std::vector<CompanionMap>& maps)
+{
+	const size_t equal = text.find('=');
+	if (equal == 0 || equal == std::string_view::npos || equal + 1 == text.size()) return false;
+
+	CompanionMap map{std::string(text.substr(0, equal)), std::string(text.substr(equal + 1))};
+	if (map.name.find_first_of("/\\") != std::string::npos) return false;
+	for (const auto& other : maps) {
+		if (other.name == map.name) return false;
+	}
+	maps.push_back(std::move(map));
+	return true;
+}
+
+}
+
+bool parseOptions(const int argc, char* argv[], Options& options, std::ostream& log)
+{
+	for (int i = 1; i < argc; i++) {
+		const std::string arg   = argv[i];
+		const char*       value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (arg == "--help") {
+			printUsage(argv[0], log);
+			return false;
+		}
+		if (arg == "--client" && value) {
+			options.client = value;
+			options.forward.assign(argv + i + 2, argv + argc);
+			return true;
+		}
+		if (arg == "--serve" && value) {
+			options.serve = value;
+			i++;
+			continue;
+		}
+		if (arg == "--input" && value) {
+			options.input = value;
+			i++;
+			continue;
+		}
+		if (arg == "--output" && value) {
+			options.output = value;
+			i++;
+			continue;
+		}
+		if (arg == "--name" && value) {
+			options.name = value;
+			i++;
+			continue;
+		}
+		if (arg == "--page-size" && value && parseSize(value, options.pageWidth, options.pageHeight)) {
+			i++;
+			continue;
+		}
+		if (arg == "--alpha" && value && parseAlphaMode(value, options.alpha)) {
+			i++;
+			continue;
+		}
+		if (arg == "--padding" && value && parseUnsigned(value, options.padding)) {
+			i++;
+			continue;
+		}
+		if (arg == "--extrude" && value && parseUnsigned(value, options.extrude)) {
+			i++;
+			continue;
+		}
+		if (arg == "--texture-format" && value && parseTextureFormat(value, options.textureFormat)) {
+			i++;
+			continue;
+		}
+		if (arg == "--png" && value && parsePngPreset(value, options.png)) {
+			i++;
+			continue;
+		}
+		if (arg == "--dither" && value && parseDitherMode(value, options.dither)) {
+			i++;
+			continue;
+		}
+		if (arg == "--container" && value && parseTextureContainer(value, options.container)) {
+			i++;
+			continue;
+		}
+		if (arg == "--supercompress") {
+			options.supercompress = true;
+			continue;
+		}
+		if (arg == "--channel-pack") {
+			options.channelPack = true;
+			continue;
+		}
+		if (arg == "--map" && value && parseMap(value, options.maps)) {
+			i++;
+			continue;
+		}
+		if (arg == "--mipmaps") {
+			options.mipmaps = true;
+			continue;
+		}
+		if (arg == "--mip-isolation" && value && parseUnsigned(value, options.mipIsolation) && options.mipIsolation <= 12) {
+			i++;
+			continue;
+		}
+		if (arg == "--optimize-ms" && value && parseUnsigned(value, options.optimizeMs)) {
+			i++;
+			continue;
+		}
+		if (arg == "--optimize-iterations" && value && parseUnsigned(value, options.optimizeIterations)) {
+			i++;
+			continue;
+		}
+		if (arg == "--pixel-limit-mb" && value && parseUnsigned(value, options.pixelLimitMb)) {
+			i++;
+			continue;
+		}
+		if (arg == "--benchmark-packing" && value && parseUnsigned(value, options.benchmarkPacking)) {
+			i++;
+			continue;
+		}
+		if (arg == "--verify-determinism") {
+			options.verifyDeterminism = true;
+			continue;
+		}
+		if (arg == "--format" && value && parseFormats(value, options.formats)) {
+			i++;
+			continue;
+		}
+		if (arg == "--header" && value) {
+			options.header = value;
+			i++;
+			continue;
+		}
+		if (arg == "--watch") {
+			options.watch = true;
+			continue;
+		}
+		if (arg == "--trace" && value) {
+			options.trace = value;
+			i++;
+			continue;
+		}
+		if (arg == "--binary") {
+			options.binary = true;
+			continue;
+		}
+		if (arg == "--threads" && value && parseUnsigned(value, options.threads)) {
+			i++;
+			continue;
+		}
+
+		log << "Error: invalid argument '" << arg << "'\n";
+		printUsage(argv[0], log);
+		return false;
+	}
+
+	// The requests of a build server run at the same time, their spans would be mixed
+	if (!options.serve.empty() && !options.trace.empty()) {
+		log << "Error: --trace cannot be used with --serve\n";
+		return false;
+	}
+
+	// The masks of a channel packed page have no companion, the other channels hold other sprites
+	if (options.channelPack && !options.maps.empty()) {
+		log << "Error: --map cannot be used with --channel-pack\n";
+		return false;
+	}
+
+	// Every channel of a mask page is a layer: rgb565 drops the alpha one, rgba5551 keeps one bit of it and bc1 makes the texels
+	// with a weak alpha transparent black, wiping the other layers
+	if (options.channelPack && (options.textureFormat == TextureFormat::Rgb565 || options.textureFormat == TextureFormat::Rgba5551
+	                            || options.textureFormat == TextureFormat::Bc1)) {
+		log << "Error: --channel-pack needs a texture format that keeps the four channels: rgba8, rgba4444, bc3 or etc2\n";
+		return false;
+	}
+
+	// DDS has no ETC2 format, neither in the FourCC codes nor in the DXGI ones
+	if (options.textureFormat == TextureFormat::Etc2 && options.container == TextureContainer::Dds) {
+		log << "Error: --texture-format etc2 needs --container ktx2\n";
+		return false;
+	}
+	return true;
+}
+
+unsigned int workerThreads(const Options& options)
+{
+	if (options.threads != 0) return options.threads;
+	return std::max(1u, std::thread::hardware_concurrency());
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "AlphaFilters.h"
+#include "PackedPixels.h"
+#include "PngWriter.h"
+#include "SheetWriter.h"
+#include "TextureWriter.h"
+
+// Images drawn with the layout of the sheet on pages of their own, like the normals or the emissive colors of the sprites
+struct CompanionMap {
+	std::string name;		// suffix of the pages: <name>_<map>.png
+	std::string folder;		// folder with an image of the same size for every sprite, under the same path
+};
+
+// Command line options of the generator
+struct Options {
+	unsigned int pageWidth          = 512;		// size of a page of the sprite sheet
+	unsigned int pageHeight         = 512;
+	unsigned int padding            = 0;		// transparent pixels between two sprites
+	unsigned int extrude            = 0;		// edge pixels of a sprite repeated around it
+	unsigned int optimizeMs         = 0;		// time budget of the layout optimizer in milliseconds
+	unsigned int optimizeIterations = 0;		// iteration budget of the layout optimizer, reproducible unlike the time budget
+	unsigned int threads            = 0;		// worker threads, 0 uses every hardware thread
+	unsigned int pixelLimitMb       = 0;		// most memory for decoded images and pages in MB, 0 for no limit
+	unsigned int benchmarkPacking   = 0;		// rounds of the packing benchmark run instead of generating the sheet, 0 for none
+	bool         verifyDeterminism  = false;	// build with 1, 4 and 32 threads and compare the files instead of generating the sheet
+	bool         binary             = false;	// also write the binary sheet read by AtlasReader.h
+	bool         watch              = false;	// rebuild every time the images change instead of showing the preview
+	bool         mipmaps            = false;	// also write the mip levels of every page
+	bool         supercompress      = false;	// deflate the levels of the KTX2 textures
+	bool         channelPack        = false;	// pack the single channel sprites into the channels of pages of their own
+	unsigned int mipIsolation       = 0;		// mip level down to which the sprites never share a texel, 0 for any pixel
+
+	std::string  input  = "images";					// folder of the images to pack
+	std::string  output = "sheets";					// folder of the pages and metadata files
+	std::string  name   = "sheet";					// filename of the sheet, without extension
+	std::string  header;								// path of the generated C++ header, empty for none
+	std::string  trace;								// path of the Chrome trace of the build, empty for none
+	std::string  serve;								// socket of the build server to run, empty to build once
+	std::string  client;								// socket of the build server to send the request to, empty to build here
+
+	std::vector<std::string>  forward;					// arguments after --client, sent to the server as they are
+	std::vector<CompanionMap> maps;						// companion maps of the sprites, drawn with their layout
+
+	std::vector<SheetFormat> formats{SheetFormat::Xml};					// text formats of the metadata
+	AlphaMode                alpha         = AlphaMode::Straight;		// color of the transparent pixels of the pages
+	TextureFormat            textureFormat = TextureFormat::Rgba8;		// format of the GPU textures written next to the PNG pages
+	DitherMode               dither        = DitherMode::None;			// rounding of the colors to the 16-bit texture formats
+	PngPreset                png           = PngPreset::Balanced;		// time spent deflating the PNG pages
+	TextureContainer         container     = TextureContainer::None;	// file of the textures, DDS if only the format is given
+};
+
+/* Parse the command line into 'options', print the usage to 'log' and return false if an argument is not valid. */
+bool parseOptions(int argc, char* argv[], Options& options, std::ostream& log = std::cout);
+
+/* The number of worker threads to use for the given options. */
+unsigned int workerThreads(const Options& options);
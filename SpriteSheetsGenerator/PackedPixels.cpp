@@ -0,0 +1,111 @@
+#include "PackedPixels.h"
+
+#include <algorithm>
+#include <cmath>
+#include "Parallel.h"
+
+namespace {
+
+// Thresholds of the ordered dithering, in sixteenths
+constexpr int BAYER[4][4] = {
+	{0, 8, 2, 10},
+	{12, 4, 14, 6},
+	{3, 11, 1, 9},
+	{15, 7, 13, 5}
+};
+
+/* Round 'value', in 0-255 and already dithered, to a channel of 'bits' bits. */
+int quantize(const float value, const int bits)
+{
+	const int levels = (1 << bits) - 1;
+	return std::clamp(static_cast<int>(std::lround(value * levels / 255.0f)), 0, levels);
+}
+
+/* The 0-255 value that the GPU reads back for a channel of 'bits' bits. */
+float expand(const int quantized, const int bits)
+{
+	return quantized * 255.0f / static_cast<float>((1 << bits) - 1);
+}
+
+void storeTexel(uint8_t* out, const uint32_t texel)
+{
+	out[0] = static_cast<uint8_t>(texel);
+	out[1] = static_cast<uint8_t>(texel >> 8);
+}
+
+}
+
+PackedLayout packedLayout(const TextureFormat format)
+{
+	switch (format) {
+	case TextureFormat::Rgb565:   return {{5, 6, 5, 0}, {11, 5, 0, 0}};
+	case TextureFormat::Rgba5551: return {{5, 5, 5, 1}, {10, 5, 0, 15}};
+	default:                      return {{4, 4, 4, 4}, {8, 4, 0, 12}};
+	}
+}
+
+bool parseDitherMode(const std::string_view text, DitherMode& mode)
+{
+	if (text == "none") mode = DitherMode::None;
+	else if (text == "ordered") mode = DitherMode::Ordered;
+	else if (text == "diffusion") mode = DitherMode::Diffusion;
+	else return false;
+	return true;
+}
+
+void packPixels(const PixelBuffer& pixels, const TextureFormat format, const DitherMode dither, std::vector<uint8_t>& texels, const unsigned int threads)
+{
+	const PackedLayout layout   = packedLayout(format);
+	const uint32_t     width    = pixels.width();
+	const int          dithered = layout.bits[3] == 1 ? 3 : 4;		// channels that are dithered, the alpha bit is a threshold
+
+	texels.resize(textureSize(format, width, pixels.height()));
+
+	if (dither != DitherMode::Diffusion) {
+		parallelFor(pixels.height(), threads, [&](const size_t y) {
+			const uint8_t* in  = pixels.row(static_cast<uint32_t>(y));
+			uint8_t*       out = texels.data() + y * width * 2;
+			for (uint32_t x = 0; x < width; x++) {
+				const float offset = dither == DitherMode::Ordered ? (BAYER[y & 3][x & 3] + 0.5f) / 16.0f - 0.5f : 0.0f;
+				uint32_t    texel  = 0;
+				for (int c = 0; c < 4; c++) {
+					if (layout.bits[c] == 0) continue;
+					const float step  = c < dithered ? 255.0f / static_cast<float>((1 << layout.bits[c]) - 1) : 0.0f;
+					texel            |= static_cast<uint32_t>(quantize(in[x * 4 + c] + offset * step, layout.bits[c])) << layout.shift[c];
+				}
+				storeTexel(out + x * 2, texel);
+			}
+		});
+		return;
+	}
+
+	// Floyd-Steinberg: 7/16 to the right, 3/16, 5/16 and 1/16 to the row below
+	std::vector<float> errors[2] = {std::vector<float>((width + 2) * 4, 0.0f), std::vector<float>((width + 2) * 4, 0.0f)};
+	for (uint32_t y = 0; y < pixels.height(); y++) {
+		const uint8_t* in      = pixels.row(y);
+		uint8_t*       out     = texels.data() + static_cast<size_t>(y) * width * 2;
+		float*         current = errors[y & 1].data() + 4;		// one pixel of margin on both sides
+		float*         below   = errors[(y + 1) & 1].data() + 4;
+		std::fill(errors[(y + 1) & 1].begin(), errors[(y + 1) & 1].end(), 0.0f);
+
+		for (uint32_t x = 0; x < width; x++) {
+			const bool transparent = in[x * 4 + 3] == 0;
+			uint32_t   texel       = 0;
+			for (int c = 0; c < 4; c++) {
+				if (layout.bits[c] == 0) continue;
+				const int   i         = static_cast<int>(x) * 4 + c;
+				const float value     = c < dithered ? in[i] + current[i] : in[i];
+				const int   quantized = quantize(value, layout.bits[c]);
+				texel |= static_cast<uint32_t>(quantized) << layout.shift[c];
+
+				if (c >= dithered || transparent) continue;
+				const float error = value - expand(quantized, layout.bits[c]);
+				current[i + 4] += error * 7.0f / 16.0f;
+				below[i - 4]   += error * 3.0f / 16.0f;
+				below[i]       += error * 5.0f / 16.0f;
+				below[i + 4]   += error * 1.0f / 16.0f;
+			}
+			storeTexel(out + x * 2, texel);
+		}
+	}
+}
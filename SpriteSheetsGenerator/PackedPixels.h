@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "PixelPool.h"
+#include "TextureFormat.h"
+
+// How the colors are rounded to the fewer bits of the 16-bit formats
+enum class DitherMode {
+	None,			// to the nearest value, flat gradients show bands
+	Ordered,		// a 4x4 Bayer threshold added before rounding, stable when the sheet is rebuilt
+	Diffusion		// Floyd-Steinberg, the rounding error of every pixel is spread over its neighbours
+};
+
+// Bits and position of the R, G, B and A channels in a 16-bit texel, 0 bits for a channel that is dropped
+struct PackedLayout {
+	int bits[4];
+	int shift[4];
+};
+
+/* The channels of Rgba4444, Rgb565 or Rgba5551. */
+PackedLayout packedLayout(TextureFormat format);
+
+/* Parse "none", "ordered" or "diffusion", return false for anything else. */
+bool parseDitherMode(std::string_view text, DitherMode& mode);
+
+/*
+   Convert 'pixels' into 16-bit 'texels' of 'format', Rgba4444, Rgb565 or Rgba5551, little endian with the channels in the
+   order of the DDS masks. The single alpha bit of Rgba5551 is a threshold at half alpha, never dithered.
+   Without error diffusion the rows are split between 'threads' workers; the error is not carried out of fully transparent
+   pixels so that a sprite does not inherit the noise of its neighbour through the padding.
+*/
+void packPixels(const PixelBuffer& pixels, TextureFormat format, DitherMode dither, std::vector<uint8_t>& texels, unsigned int threads);
@@ -0,0 +1,170 @@
+#include "Packer.h"
+
+#include <algorithm>
+#include <numeric>
+
+PackArena::PackArena(const size_t bytes, std::pmr::memory_resource* upstream)
+	: m_buffer(bytes),
+	  m_resource(m_buffer.data(), m_buffer.size(), upstream) {}
+
+Layout packLayout(const std::vector<rbp::RectSize>& sizes,
+				  const std::vector<uint32_t>& order,
+				  const std::vector<char>& allowFlip,
+				  const rbp::MaxRectsBinPack::FreeRectChoiceHeuristic heuristic,
+				  const int binWidth, const int binHeight,
+				  std::pmr::memory_resource* scratch)
+{
+	Layout layout;
+	layout.heuristic = heuristic;
+	layout.placements.resize(sizes.size());
+
+	std::pmr::vector<rbp::MaxRectsBinPack> pages(scratch);
+	std::pmr::vector<rbp::Rect>            extents(scratch);	// bounding box of the used area of every page
+	long long                              usedArea = 0;
+
+	for (const uint32_t index : order) {
+		const rbp::RectSize& size = sizes[index];
+		const bool           flip = allowFlip.empty() || allowFlip[index] != 0;
+		Placement&           placement = layout.placements[index];
+
+		// Try the pages already opened first, then an empty one
+		for (size_t page = 0; page <= pages.size(); page++) {
+			if (page == pages.size()) {
+				pages.emplace_back(binWidth, binHeight, scratch);
+				extents.push_back({});
+			}
+
+			const rbp::Rect rect = pages[page].insert(size.width, size.height, heuristic, flip);
+			if (rect.height <= 0) {
+				// An image that does not fit in an empty page will never fit
+				if (page + 1 == pages.size() && pages[page].occupancy() == 0) {
+#ifdef RBP_PACK_STATS
+					layout.stats += pages.back().stats();
+#endif
+					pages.pop_back();
+					extents.pop_back();
+					break;
+				}
+				continue;
+			}
+
+			placement.page    = static_cast<int>(page);
+			placement.rect    = rect;
+			placement.rotated = rect.width != size.width;
+			usedArea += static_cast<long long>(rect.width) * rect.height;
+
+			rbp::Rect& extent = extents[page];
+			extent.width  = std::max(extent.width, rect.x + rect.width);
+			extent.height = std::max(extent.height, rect.y + rect.height);
+			break;
+		}
+
+		if (placement.page < 0) layout.unplaced++;
+	}
+
+	layout.pages = pages.size();
+#ifdef RBP_PACK_STATS
+	for (const auto& page : pages) layout.stats += page.stats();
+	layout.searchStats = layout.stats;
+#endif
+	if (!extents.empty()) layout.lastPageExtent = static_cast<long long>(extents.back().width) * extents.back().height;
+	if (layout.pages > 0) layout.occupancy = static_cast<float>(usedArea) / (static_cast<float>(binWidth) * binHeight * layout.pages);
+
+	return layout;
+}
+
+std::vector<rbp::RectSize> inflateSizes(const std::vector<rbp::RectSize>& sizes, const int padding, const int extrude)
+{
+	std::vector<rbp::RectSize> inflated = sizes;
+	for (auto& size : inflated) {
+		size.width += 2 * extrude + padding;
+		size.height += 2 * extrude + padding;
+	}
+	return inflated;
+}
+
+rbp::Rect innerRect(const rbp::Rect& packed, const int padding, const int extrude)
+{
+	// The border is the same on both axes so it does not matter whether the image is rotated
+	rbp::Rect inner = packed;
+	inner.x += extrude;
+	inner.y += extrude;
+	inner.width -= 2 * extrude + padding;
+	inner.height -= 2 * extrude + padding;
+	return inner;
+}
+
+std::vector<rbp::RectSize> toCellSizes(const std::vector<rbp::RectSize>& sizes, const int granularity)
+{
+	std::vector<rbp::RectSize> cells = sizes;
+	for (auto& size : cells) {
+		size.width  = (size.width + granularity - 1) / granularity;
+		size.height = (size.height + granularity - 1) / granularity;
+	}
+	return cells;
+}
+
+void fromCellLayout(Layout& layout, const std::vector<rbp::RectSize>& sizes, const int granularity)
+{
+	for (size_t i = 0; i < sizes.size(); i++) {
+		Placement& placement = layout.placements[i];
+		if (placement.page < 0) continue;
+
+		placement.rect.x *= granularity;
+		placement.rect.y *= granularity;
+		placement.rect.width  = placement.rotated ? sizes[i].height : sizes[i].width;
+		placement.rect.height = placement.rotated ? sizes[i].width : sizes[i].height;
+	}
+	layout.lastPageExtent *= static_cast<long long>(granularity) * granularity;
+}
+
+double layoutCost(const Layout& layout, const int binWidth, const int binHeight)
+{
+	// Every term is bounded by the weight of the previous one so the cost stays lexicographic
+	const double pageArea = static_cast<double>(binWidth) * binHeight;
+	const double maxPages = static_cast<double>(layout.placements.size()) + 1;
+	return (static_cast<double>(layout.unplaced) * maxPages + static_cast<double>(layout.pages)) * pageArea + static_cast<double>(layout.lastPageExtent);
+}
+
+uint64_t hashLayout(const Layout& layout)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	auto     mix  = [&hash](const int value) {
+		// Hash the bytes in a fixed order so the result does not depend on the endianness
+		const auto bits = static_cast<uint32_t>(value);
+		for (int shift = 0; shift < 32; shift += 8) {
+			hash ^= (bits >> shift) & 0xff;
+			hash *= 0x100000001b3ull;
+		}
+	};
+
+	for (const auto& placement : layout.placements) {
+		mix(placement.page);
+		mix(placement.rect.x);
+		mix(placement.rect.y);
+		mix(placement.rect.width);
+		mix(placement.rect.height);
+		mix(placement.rotated ? 1 : 0);
+		if (placement.channel >= 0) mix(placement.channel);		// layouts without channel packing keep their hash
+	}
+	return hash;
+}
+
+std::vector<uint32_t> identityOrder(const size_t count)
+{
+	std::vector<uint32_t> order(count);
+	std::iota(order.begin(), order.end(), 0u);
+	return order;
+}
+
+#ifdef RBP_PACK_STATS
+void writePackStats(std::ostream& out, const rbp::PackStats& stats)
+{
+	const double insertMicroseconds = stats.inserts == 0 ? 0.0 : static_cast<double>(stats.insertNanoseconds) / 1000.0 / static_cast<double>(stats.inserts);
+
+	out << "{\"inserts\":" << stats.inserts << ",\"insertUs\":" << insertMicroseconds << ",\"scores\":" << stats.scores
+	    << ",\"scoredFreeRects\":" << stats.scoredFreeRects << ",\"freeRectsHighWater\":" << stats.freeRectsHighWater
+	    << ",\"splitCalls\":" << stats.splitCalls << ",\"splitRects\":" << stats.splitRects << ",\"pruneTests\":" << stats.pruneTests
+	    << ",\"pruneRemovals\":" << stats.pruneRemovals << "}";
+}
+#endif
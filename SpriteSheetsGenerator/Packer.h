@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <ostream>
+#include <vector>
+#include "MaxRectsBinPack.h"
+
+// Where one image ended up after packing
+struct Placement {
+	int       page = -1;		// index of the sheet page, -1 if the image does not fit in an empty page
+	rbp::Rect rect{};			// packed rectangle, width and height are swapped when rotated
+	bool      rotated = false;
+	int       channel = -1;			// plane of a channel packed page, -1 for a sprite that uses whole pixels
+};
+
+// Result of packing every image of a sheet, indexed like the input sizes
+struct Layout {
+	std::vector<Placement>                        placements;
+	rbp::MaxRectsBinPack::FreeRectChoiceHeuristic heuristic = rbp::MaxRectsBinPack::RectBestAreaFit;
+	size_t                                        pages     = 0;
+	size_t                                        unplaced  = 0;
+	long long                                     lastPageExtent = 0;	// area of the bounding box of the last page
+	float                                         occupancy = 0;	// used area over the area of every page
+#ifdef RBP_PACK_STATS
+	rbp::PackStats                                stats;			// work of the packers of the pages, see Rect.h
+	rbp::PackStats                                searchStats;	// work of every pack tried to find this layout, this one included
+#endif
+};
+
+/*
+   Scratch memory for the packers of a trial pack: a fixed buffer handed out by a monotonic resource and rewound before every pack,
+   so evaluating a layout does not touch the heap once the buffer is big enough. Allocations past the buffer fall back to the heap.
+   An arena is not thread safe, use one per thread.
+*/
+class PackArena {
+public:
+	explicit PackArena(size_t bytes = 1 << 20, std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+	PackArena(const PackArena&) = delete;
+	PackArena& operator=(const PackArena&) = delete;
+
+	/* Forget everything allocated since the last rewind, the packers using the arena must be destroyed. */
+	void rewind()
+	{
+		m_resource.release();
+	}
+
+	std::pmr::memory_resource* resource()
+	{
+		return &m_resource;
+	}
+
+private:
+	std::vector<std::byte>              m_buffer;
+	std::pmr::monotonic_buffer_resource m_resource;
+};
+
+/*
+   Pack the images in the given order, opening a new page when an image does not fit in the pages already opened.
+   'allowFlip' can be empty (every image may rotate) or hold one flag per image.
+   The packers of the pages are allocated on 'scratch' and destroyed before returning, the layout itself is on the heap.
+*/
+Layout packLayout(const std::vector<rbp::RectSize>& sizes,
+				  const std::vector<uint32_t>& order,
+				  const std::vector<char>& allowFlip,
+				  rbp::MaxRectsBinPack::FreeRectChoiceHeuristic heuristic,
+				  int binWidth, int binHeight,
+				  std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+/*
+   Grow every size by the space reserved around an image: 'extrude' pixels on every side for the repeated edge pixels, then 'padding'
+   transparent pixels on the right and at the bottom. Pack into pages grown by 'padding' too so that the last column and row lose nothing.
+*/
+std::vector<rbp::RectSize> inflateSizes(const std::vector<rbp::RectSize>& sizes, int padding, int extrude);
+
+/* The image inside a rectangle packed with the sizes given by inflateSizes. */
+rbp::Rect innerRect(const rbp::Rect& packed, int padding, int extrude);
+
+/*
+   Sizes in cells of 'granularity' pixels, rounded up. Packing the cells into a page of cells places every rectangle on a grid of
+   'granularity' pixels, so that no two sprites share a texel of the mip level log2(granularity).
+*/
+std::vector<rbp::RectSize> toCellSizes(const std::vector<rbp::RectSize>& sizes, int granularity);
+
+/* Turn a layout of toCellSizes back into pixels: the positions are scaled up and the rectangles get their size before rounding. */
+void fromCellLayout(Layout& layout, const std::vector<rbp::RectSize>& sizes, int granularity);
+
+/* Cost to minimize: unplaced images first, then pages, then the extent of the last page. */
+double layoutCost(const Layout& layout, int binWidth, int binHeight);
+
+/* FNV-1a hash of the placements, two layouts with the same hash are rendered the same. */
+uint64_t hashLayout(const Layout& layout);
+
+/* The identity order 0, 1, ..., count - 1. */
+std::vector<uint32_t> identityOrder(size_t count);
+
+#ifdef RBP_PACK_STATS
+/* Write the counters of the packers as one JSON object, with the insert time averaged over the rectangles placed. */
+void writePackStats(std::ostream& out, const rbp::PackStats& stats);
+#endif
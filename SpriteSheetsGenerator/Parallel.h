@@ -0,0 +1,31 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/*
+   Call function(i) for every i in [0, count) on up to 'threads' threads, the calling thread included.
+   Indices are handed out dynamically so the function must only write to the slot of its own index,
+   reductions are done by the caller afterwards in index order to stay independent of the scheduling.
+*/
+template <typename Function>
+void parallelFor(const size_t count, const unsigned int threads, Function&& function)
+{
+	const size_t workers = std::min<size_t>(threads, count);
+	if (workers <= 1) {
+		for (size_t i = 0; i < count; i++) function(i);
+		return;
+	}
+
+	std::atomic<size_t> next{0};
+	auto work = [&]() {
+		for (size_t i = next++; i < count; i = next++) function(i);
+	};
+
+	std::vector<std::thread> pool;
+	for (size_t i = 1; i < workers; i++) pool.emplace_back(work);
+	work();
+	for (auto& thread : pool) thread.join();
+}
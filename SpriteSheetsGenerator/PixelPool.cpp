@@ -0,0 +1,160 @@
+#include "PixelPool.h"
+
+#include <algorithm>
+
+namespace {
+
+// Smallest slab, 32x32 pixels
+constexpr size_t MIN_SLAB_BYTES = 4096;
+
+}
+
+PixelBuffer::PixelBuffer(PixelBuffer&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+PixelBuffer& PixelBuffer::operator=(PixelBuffer&& other) noexcept
+{
+	if (this != &other) {
+		release();
+		m_pool      = other.m_pool;
+		m_data      = other.m_data;
+		m_width     = other.m_width;
+		m_height    = other.m_height;
+		m_sizeClass = other.m_sizeClass;
+		other.m_pool = nullptr;
+		other.m_data = nullptr;
+	}
+	return *this;
+}
+
+PixelBuffer::~PixelBuffer()
+{
+	release();
+}
+
+void PixelBuffer::release()
+{
+	if (m_pool && m_data) m_pool->giveBack(m_data, m_sizeClass);
+	m_pool   = nullptr;
+	m_data   = nullptr;
+	m_width  = 0;
+	m_height = 0;
+}
+
+PixelPool::PixelPool(const size_t limit)
+	: m_limit(limit) {}
+
+uint32_t PixelPool::classOf(const size_t bytes)
+{
+	uint32_t sizeClass = 0;
+	while (classBytes(sizeClass) < bytes) sizeClass++;
+	return sizeClass;
+}
+
+size_t PixelPool::classBytes(const uint32_t sizeClass)
+{
+	// Four steps per power of two: 4, 5, 6, 7, 8, 10, 12, 14, 16 KB...
+	const size_t base = MIN_SLAB_BYTES << (sizeClass / 4);
+	return base + base / 4 * (sizeClass % 4);
+}
+
+PixelBuffer PixelPool::acquire(const uint32_t width, const uint32_t height)
+{
+	PixelBuffer buffer;
+	const size_t   bytes     = static_cast<size_t>(width) * height * 4;
+	const uint32_t sizeClass = classOf(bytes);
+	const size_t   slabBytes = classBytes(sizeClass);
+
+	std::unique_ptr<uint8_t[]> slab;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (sizeClass < m_free.size() && !m_free[sizeClass].empty()) {
+			slab = std::move(m_free[sizeClass].back());
+			m_free[sizeClass].pop_back();
+		}
+		else {
+			makeRoom(slabBytes);
+			if (m_limit != 0 && m_held + slabBytes > m_limit) return buffer;
+			m_held += slabBytes;
+		}
+
+		m_inUse += slabBytes;
+		m_highWater = std::max(m_highWater, m_inUse);
+	}
+
+	// Allocate outside of the lock, new slabs are only needed while the pool warms up
+	if (!slab) slab.reset(new uint8_t[slabBytes]);
+
+	buffer.m_pool      = this;
+	buffer.m_data      = slab.release();
+	buffer.m_width     = width;
+	buffer.m_height    = height;
+	buffer.m_sizeClass = sizeClass;
+	return buffer;
+}
+
+void PixelPool::giveBack(uint8_t* data, const uint32_t sizeClass)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_free.size() <= sizeClass) m_free.resize(sizeClass + 1);
+	m_free[sizeClass].emplace_back(data);
+	m_inUse -= classBytes(sizeClass);
+}
+
+void PixelPool::makeRoom(const size_t bytes)
+{
+	if (m_limit == 0) return;
+
+	for (size_t sizeClass = m_free.size(); sizeClass-- > 0 && m_held + bytes > m_limit;) {
+		auto& slabs = m_free[sizeClass];
+		while (!slabs.empty() && m_held + bytes > m_limit) {
+			slabs.pop_back();
+			m_held -= classBytes(static_cast<uint32_t>(sizeClass));
+		}
+	}
+}
+
+void PixelPool::trim()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (size_t sizeClass = 0; sizeClass < m_free.size(); sizeClass++) {
+		m_held -= m_free[sizeClass].size() * classBytes(static_cast<uint32_t>(sizeClass));
+		m_free[sizeClass].clear();
+	}
+}
+
+void PixelPool::setLimit(const size_t limit)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_limit = limit;
+	makeRoom(0);
+}
+
+size_t PixelPool::getLimit() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_limit;
+}
+
+size_t PixelPool::inUse() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_inUse;
+}
+
+size_t PixelPool::held() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_held;
+}
+
+size_t PixelPool::highWater() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_highWater;
+}
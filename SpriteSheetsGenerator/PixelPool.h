@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class PixelPool;
+
+// RGBA8 pixels borrowed from a PixelPool, given back when destroyed
+class PixelBuffer {
+public:
+	PixelBuffer() = default;
+	PixelBuffer(const PixelBuffer&) = delete;
+	PixelBuffer& operator=(const PixelBuffer&) = delete;
+	PixelBuffer(PixelBuffer&& other) noexcept;
+	PixelBuffer& operator=(PixelBuffer&& other) noexcept;
+	~PixelBuffer();
+
+	/* Give the memory back to the pool now. */
+	void release();
+
+	explicit operator bool() const
+	{
+		return m_data != nullptr;
+	}
+
+	uint8_t* data() { return m_data; }
+	const uint8_t* data() const { return m_data; }
+	uint32_t width() const { return m_width; }
+	uint32_t height() const { return m_height; }
+	size_t stride() const { return static_cast<size_t>(m_width) * 4; }
+	size_t bytes() const { return stride() * m_height; }
+
+	uint8_t* row(const uint32_t y) { return m_data + y * stride(); }
+	const uint8_t* row(const uint32_t y) const { return m_data + y * stride(); }
+
+private:
+	friend class PixelPool;
+
+	PixelPool* m_pool      = nullptr;
+	uint8_t*   m_data      = nullptr;
+	uint32_t   m_width     = 0;
+	uint32_t   m_height    = 0;
+	uint32_t   m_sizeClass = 0;
+};
+
+/*
+   Pool of pixel slabs for decoded sprites and sheet pages.
+   Requests are rounded up to a size class (four classes per power of two so at most 25% is wasted) and released slabs are kept
+   in a free list per class, so the pages of a sheet and the sprites of the next build reuse the same memory instead of going
+   back to the heap. The pool is thread safe and must outlive the buffers it lends.
+*/
+class PixelPool {
+public:
+	/* 'limit' is the most bytes the pool may hold, free slabs included, 0 for no limit. */
+	explicit PixelPool(size_t limit = 0);
+	PixelPool(const PixelPool&) = delete;
+	PixelPool& operator=(const PixelPool&) = delete;
+
+	/* Borrow a width x height buffer, the content is undefined. The buffer is empty if the limit would be exceeded. */
+	PixelBuffer acquire(uint32_t width, uint32_t height);
+
+	/* Free every slab that is not borrowed. */
+	void trim();
+
+	void setLimit(size_t limit);
+
+	size_t getLimit() const;
+	size_t inUse() const;			// bytes borrowed right now
+	size_t held() const;			// bytes borrowed or kept in the free lists
+	size_t highWater() const;		// most bytes borrowed at the same time
+
+private:
+	friend class PixelBuffer;
+
+	void giveBack(uint8_t* data, uint32_t sizeClass);
+
+	/* Free slabs, largest first, until 'bytes' more fit under the limit. Called with the mutex locked. */
+	void makeRoom(size_t bytes);
+
+	static uint32_t classOf(size_t bytes);
+	static size_t   classBytes(uint32_t sizeClass);
+
+	mutable std::mutex                                   m_mutex;
+	std::vector<std::vector<std::unique_ptr<uint8_t[]>>> m_free;		// free slabs of every size class
+	size_t                                               m_limit     = 0;
+	size_t                                               m_inUse     = 0;
+	size_t                                               m_held      = 0;
+	size_t                                               m_highWater = 0;
+};
@@ -0,0 +1,283 @@
+#include "PngReader.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <zlib.h>
+
+namespace {
+
+constexpr uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+constexpr size_t  HEADER_BYTES     = 8 + 8 + 13 + 4;		// signature, chunk length and type, IHDR and its CRC
+
+// Color types of the PNG header
+enum PngColor : uint8_t {
+	ColorGray      = 0,
+	ColorRgb       = 2,
+	ColorPalette   = 3,
+	ColorGrayAlpha = 4,
+	ColorRgba      = 6
+};
+
+struct PngHeader {
+	uint32_t width     = 0;
+	uint32_t height    = 0;
+	uint8_t  bitDepth  = 0;
+	uint8_t  colorType = 0;
+	uint8_t  interlace = 0;
+};
+
+uint32_t getU32BE(const uint8_t* in)
+{
+	return static_cast<uint32_t>(in[0]) << 24 | static_cast<uint32_t>(in[1]) << 16 | static_cast<uint32_t>(in[2]) << 8 | in[3];
+}
+
+/* Parse the signature and the IHDR chunk from the HEADER_BYTES first bytes of a file, the next chunk follows them. */
+bool readHeader(const uint8_t* bytes, PngHeader& header)
+{
+	if (!std::equal(PNG_SIGNATURE, PNG_SIGNATURE + 8, bytes) || getU32BE(bytes + 8) != 13 || std::memcmp(bytes + 12, "IHDR", 4) != 0) return false;
+
+	header.width     = getU32BE(bytes + 16);
+	header.height    = getU32BE(bytes + 20);
+	header.bitDepth  = bytes[24];
+	header.colorType = bytes[25];
+	header.interlace = bytes[28];
+	return header.width > 0 && header.height > 0;
+}
+
+size_t channelCount(const uint8_t colorType)
+{
+	switch (colorType) {
+		case ColorGray:
+		case ColorPalette: return 1;
+		case ColorGrayAlpha: return 2;
+		case ColorRgb: return 3;
+		case ColorRgba: return 4;
+		default: return 0;
+	}
+}
+
+bool isSupported(const PngHeader& header)
+{
+	if (header.interlace != 0) return false;
+	if (header.colorType == ColorGray || header.colorType == ColorPalette) {
+		return header.bitDepth == 1 || header.bitDepth == 2 || header.bitDepth == 4 || header.bitDepth == 8;
+	}
+	return channelCount(header.colorType) > 0 && header.bitDepth == 8;
+}
+
+/* Undo the filter of a row in place, 'above' is the row before it once unfiltered, zeros for the first row. */
+bool unfilterRow(const uint8_t filter, uint8_t* row, const uint8_t* above, const size_t bytes, const size_t bpp)
+{
+	switch (filter) {
+		case 0: return true;
+		case 1:
+			for (size_t i = bpp; i < bytes; i++) row[i] = static_cast<uint8_t>(row[i] + row[i - bpp]);
+			return true;
+		case 2:
+			for (size_t i = 0; i < bytes; i++) row[i] = static_cast<uint8_t>(row[i] + above[i]);
+			return true;
+		case 3:
+			for (size_t i = 0; i < bytes; i++) {
+				const int left = i >= bpp ? row[i - bpp] : 0;
+				row[i]         = static_cast<uint8_t>(row[i] + (left + above[i]) / 2);
+			}
+			return true;
+		case 4:
+			for (size_t i = 0; i < bytes; i++) {
+				const int a  = i >= bpp ? row[i - bpp] : 0;
+				const int b  = above[i];
+				const int c  = i >= bpp ? above[i - bpp] : 0;
+				const int p  = a + b - c;
+				const int pa = std::abs(p - a);
+				const int pb = std::abs(p - b);
+				const int pc = std::abs(p - c);
+				row[i]       = static_cast<uint8_t>(row[i] + (pa <= pb && pa <= pc ? a : pb <= pc ? b : c));
+			}
+			return true;
+		default: return false;
+	}
+}
+
+// Turns the unfiltered samples of a row into RGBA pixels, with the palette and the transparent color of the file
+class RowConverter {
+public:
+	explicit RowConverter(const PngHeader& header)
+		: m_header(header)
+	{
+		for (auto& entry : m_palette) entry[3] = 255;
+	}
+
+	void setPalette(const uint8_t* colors, const size_t count)
+	{
+		for (size_t i = 0; i < count && i < 256; i++) std::copy(colors + 3 * i, colors + 3 * i + 3, m_palette[i]);
+	}
+
+	/* The tRNS chunk: alpha of the palette entries, or the one gray or RGB value that is transparent. */
+	void setTransparency(const uint8_t* data, const size_t bytes)
+	{
+		if (m_header.colorType == ColorPalette) {
+			for (size_t i = 0; i < bytes && i < 256; i++) m_palette[i][3] = data[i];
+		}
+		else if ((m_header.colorType == ColorGray && bytes >= 2) || (m_header.colorType == ColorRgb && bytes >= 6)) {
+			for (size_t i = 0; i < bytes / 2 && i < 3; i++) m_key[i] = static_cast<uint16_t>(data[2 * i] << 8 | data[2 * i + 1]);
+			m_hasKey = true;
+		}
+	}
+
+	void convert(const uint8_t* samples, uint8_t* rgba) const
+	{
+		const uint32_t width = m_header.width;
+		const int      depth = m_header.bitDepth;
+
+		switch (m_header.colorType) {
+			case ColorGray:
+			case ColorPalette: {
+				const int mask = (1 << depth) - 1;
+				for (uint32_t x = 0; x < width; x++) {
+					const size_t bit   = static_cast<size_t>(x) * depth;
+					const int    value = samples[bit / 8] >> (8 - depth - static_cast<int>(bit % 8)) & mask;
+					uint8_t*     out   = rgba + 4 * static_cast<size_t>(x);
+					if (m_header.colorType == ColorPalette) {
+						std::copy(m_palette[value], m_palette[value] + 4, out);
+						continue;
+					}
+					const auto gray = static_cast<uint8_t>(value * 255 / mask);
+					out[0] = out[1] = out[2] = gray;
+					out[3] = m_hasKey && value == m_key[0] ? 0 : 255;
+				}
+				return;
+			}
+			case ColorGrayAlpha:
+				for (uint32_t x = 0; x < width; x++) {
+					uint8_t* out = rgba + 4 * static_cast<size_t>(x);
+					out[0] = out[1] = out[2] = samples[2 * x];
+					out[3] = samples[2 * x + 1];
+				}
+				return;
+			case ColorRgb:
+				for (uint32_t x = 0; x < width; x++) {
+					const uint8_t* in  = samples + 3 * static_cast<size_t>(x);
+					uint8_t*       out = rgba + 4 * static_cast<size_t>(x);
+					std::copy(in, in + 3, out);
+					out[3] = m_hasKey && in[0] == m_key[0] && in[1] == m_key[1] && in[2] == m_key[2] ? 0 : 255;
+				}
+				return;
+			default:
+				std::memcpy(rgba, samples, static_cast<size_t>(width) * 4);
+				return;
+		}
+	}
+
+private:
+	PngHeader m_header;
+	uint8_t   m_palette[256][4] = {};
+	uint16_t  m_key[3]          = {};
+	bool      m_hasKey          = false;
+};
+
+}
+
+bool readPngSize(const std::string& path, uint32_t& width, uint32_t& height)
+{
+	std::ifstream file(path, std::ios::binary);
+	uint8_t       bytes[HEADER_BYTES];
+	PngHeader     header;
+	if (!file.read(reinterpret_cast<char*>(bytes), sizeof(bytes)) || !readHeader(bytes, header)) return false;
+
+	width  = header.width;
+	height = header.height;
+	return true;
+}
+
+bool decodePng(const uint8_t* data, const size_t size, PixelBuffer& page, const Placement& placement)
+{
+	PngHeader header;
+	if (size < HEADER_BYTES || !readHeader(data, header) || !isSupported(header)) return false;
+
+	const rbp::Rect& rect   = placement.rect;
+	const auto       width  = static_cast<uint32_t>(placement.rotated ? rect.height : rect.width);
+	const auto       height = static_cast<uint32_t>(placement.rotated ? rect.width : rect.height);
+	if (header.width != width || header.height != height) return false;
+
+	const size_t channels = channelCount(header.colorType);
+	const size_t rowBytes = (static_cast<size_t>(header.width) * channels * header.bitDepth + 7) / 8;
+	const size_t bpp      = std::max<size_t>(1, channels * header.bitDepth / 8);
+
+	// The row being inflated, its filter type first, and the row above it once unfiltered
+	std::vector<uint8_t>  rows(2 * (rowBytes + 1), 0);
+	uint8_t*              current = rows.data();
+	uint8_t*              above   = rows.data() + rowBytes + 1;
+	std::vector<uint32_t> turned(placement.rotated ? header.width : 0);		// row of a rotated sprite before it is written as a column
+	RowConverter          converter(header);
+
+	z_stream stream{};
+	if (inflateInit(&stream) != Z_OK) return false;
+
+	uint32_t y      = 0;		// next row of the image
+	size_t   filled = 0;		// bytes of the current row already inflated
+	size_t   offset = HEADER_BYTES;		// next chunk
+	bool     failed = false;
+
+	while (y < header.height && !failed) {
+		if (size - offset < 8) break;
+		const uint32_t length = getU32BE(data + offset);
+		const char*    type   = reinterpret_cast<const char*>(data + offset + 4);
+		const uint8_t* chunk  = data + offset + 8;
+		if (size - offset - 8 < length) {
+			failed = true;		// truncated file
+			break;
+		}
+		offset = std::min(size, offset + 8 + length + 4);		// the CRC is not checked
+
+		if (std::memcmp(type, "IDAT", 4) == 0) {
+			stream.next_in  = const_cast<Bytef*>(chunk);		// zlib only reads it
+			stream.avail_in = length;
+
+			// Each row is unfiltered and written to the page as soon as it is complete
+			while (stream.avail_in > 0 && y < header.height) {
+				stream.next_out  = current + filled;
+				stream.avail_out = static_cast<uInt>(rowBytes + 1 - filled);
+				const int result = inflate(&stream, Z_NO_FLUSH);
+				filled           = rowBytes + 1 - stream.avail_out;
+
+				if (filled == rowBytes + 1) {
+					if (!unfilterRow(current[0], current + 1, above + 1, rowBytes, bpp)) {
+						failed = true;
+						break;
+					}
+					if (!placement.rotated) {
+						converter.convert(current + 1, page.row(static_cast<uint32_t>(rect.y) + y) + static_cast<size_t>(rect.x) * 4);
+					}
+					else {
+						// Turned clockwise: the row y becomes the column (height - 1 - y)
+						converter.convert(current + 1, reinterpret_cast<uint8_t*>(turned.data()));
+						for (uint32_t x = 0; x < header.width; x++) {
+							uint8_t* row = page.row(static_cast<uint32_t>(rect.y) + x);
+							std::memcpy(row + 4 * (static_cast<size_t>(rect.x) + header.height - 1 - y), &turned[x], 4);
+						}
+					}
+					std::swap(current, above);
+					filled = 0;
+					y++;
+				}
+				if (result != Z_OK) {
+					failed = result != Z_STREAM_END || y < header.height;
+					break;
+				}
+			}
+			continue;
+		}
+
+		if (std::memcmp(type, "IEND", 4) == 0) break;
+
+		// The palette and the transparency come before the pixels, every other chunk is skipped
+		if (std::memcmp(type, "PLTE", 4) == 0 && length <= 768) converter.setPalette(chunk, length / 3);
+		else if (std::memcmp(type, "tRNS", 4) == 0 && length <= 768) converter.setTransparency(chunk, length);
+	}
+
+	inflateEnd(&stream);
+	return !failed && y == header.height;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "Packer.h"
+#include "PixelPool.h"
+
+/* Read the size of the PNG file 'path' from its header without decoding it, return false if it is not a PNG file. */
+bool readPngSize(const std::string& path, uint32_t& width, uint32_t& height);
+
+/*
+   Decode the PNG file held in 'data' straight into the rectangle of 'placement' in 'page', turned 90 degrees clockwise like blitSprite
+   if the placement is rotated. The file is inflated chunk by chunk and only two rows are kept, so no buffer of the size of the decoded
+   image is ever allocated. Every bit depth up to 8 of the five color types is handled, transparency chunk included.
+   Return false, leaving the rectangle undefined, for a file that is not such a PNG (16 bits, interlaced, corrupt or of another
+   size than the rectangle) so that the caller can fall back to the generic decoder.
+*/
+bool decodePng(const uint8_t* data, size_t size, PixelBuffer& page, const Placement& placement);
@@ -0,0 +1,231 @@
+#include "PngWriter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+#include <zlib.h>
+#include "AtomicFile.h"
+#include "Parallel.h"
+#include "Trace.h"
+
+namespace {
+
+constexpr uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+constexpr uint8_t PNG_COLOR_RGBA   = 6;
+constexpr size_t  DEFLATE_WINDOW   = 32768;		// bytes a deflate stream can refer back to
+constexpr size_t  PIXEL_BYTES      = 4;
+
+// Filter types of a PNG row
+enum RowFilter : uint8_t {
+	FilterNone,
+	FilterSub,
+	FilterUp,
+	FilterAverage,
+	FilterPaeth,
+	FilterCount
+};
+
+struct PresetSettings {
+	int    level;			// deflate level
+	bool   adaptive;		// choose the filter of every row, else Sub
+	size_t chunkBytes;		// filtered bytes deflated by one worker, more gives a better ratio and less parallelism
+};
+
+PresetSettings presetSettings(const PngPreset preset)
+{
+	switch (preset) {
+		case PngPreset::Fast: return {1, false, 256 * 1024};
+		case PngPreset::Small: return {9, true, 2048 * 1024};
+		default: return {6, true, 512 * 1024};
+	}
+}
+
+uint8_t paethPredictor(const int a, const int b, const int c)
+{
+	const int p  = a + b - c;
+	const int pa = std::abs(p - a);
+	const int pb = std::abs(p - b);
+	const int pc = std::abs(p - c);
+	if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+	return static_cast<uint8_t>(pb <= pc ? b : c);
+}
+
+/* The prediction of byte i of 'row' by every filter, 'above' is the row before it. */
+void predict(const uint8_t* row, const uint8_t* above, const size_t i, uint8_t (&prediction)[FilterCount])
+{
+	const int a = i >= PIXEL_BYTES ? row[i - PIXEL_BYTES] : 0;
+	const int b = above[i];
+	const int c = i >= PIXEL_BYTES ? above[i - PIXEL_BYTES] : 0;
+
+	prediction[FilterNone]    = 0;
+	prediction[FilterSub]     = static_cast<uint8_t>(a);
+	prediction[FilterUp]      = static_cast<uint8_t>(b);
+	prediction[FilterAverage] = static_cast<uint8_t>((a + b) / 2);
+	prediction[FilterPaeth]   = paethPredictor(a, b, c);
+}
+
+/*
+   Filter 'row' into 'out', its filter type then 'bytes' residuals. 'above' is the row before it, zeros for the first row.
+   The adaptive choice sums the residuals of every filter as signed bytes in a single pass over the row, then writes the best one.
+*/
+void filterRow(const uint8_t* row, const uint8_t* above, const size_t bytes, const bool adaptive, uint8_t* out)
+{
+	uint8_t   prediction[FilterCount];
+	RowFilter best = FilterSub;
+
+	if (adaptive) {
+		uint64_t cost[FilterCount] = {};
+		for (size_t i = 0; i < bytes; i++) {
+			predict(row, above, i, prediction);
+			for (int filter = FilterNone; filter < FilterCount; filter++) {
+				const auto residual  = static_cast<uint8_t>(row[i] - prediction[filter]);
+				cost[filter]        += std::min<uint32_t>(residual, 256 - residual);
+			}
+		}
+		best = static_cast<RowFilter>(std::min_element(cost, cost + FilterCount) - cost);
+	}
+
+	out[0] = best;
+	for (size_t i = 0; i < bytes; i++) {
+		predict(row, above, i, prediction);
+		out[i + 1] = static_cast<uint8_t>(row[i] - prediction[best]);
+	}
+}
+
+// One chunk of the zlib stream, deflated by one worker
+struct DeflatedChunk {
+	std::vector<uint8_t> data;
+	uLong                adler  = 0;		// Adler-32 of the filtered bytes of the chunk
+	size_t               length = 0;		// filtered bytes of the chunk
+	bool                 ok     = false;
+};
+
+/* Filter rows [first, last) and deflate them as a raw stream primed with the rows before them, ended with a sync flush or finished. */
+void deflateRows(const PixelBuffer& pixels, const uint32_t first, const uint32_t last, const PresetSettings& settings, DeflatedChunk& chunk)
+{
+	const size_t   stride   = pixels.stride();
+	const size_t   rowBytes = stride + 1;
+	const uint32_t primed   = std::min<uint32_t>(first, static_cast<uint32_t>((DEFLATE_WINDOW + rowBytes - 1) / rowBytes));
+	const uint32_t from     = first - primed;
+
+	// The rows of the dictionary are filtered again rather than shared, so that no chunk waits for another
+	const std::vector<uint8_t> zeros(stride, 0);
+	std::vector<uint8_t>       filtered((last - from) * rowBytes);
+	for (uint32_t y = from; y < last; y++) {
+		filterRow(pixels.row(y), y > 0 ? pixels.row(y - 1) : zeros.data(), stride, settings.adaptive, filtered.data() + (y - from) * rowBytes);
+	}
+
+	const uint8_t* input      = filtered.data() + primed * rowBytes;
+	const size_t   inputBytes = (last - first) * rowBytes;
+	const bool     finish     = last == pixels.height();
+
+	z_stream stream{};
+	if (deflateInit2(&stream, settings.level, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY) != Z_OK) return;
+	if (primed > 0) {
+		const size_t dictionary = std::min(DEFLATE_WINDOW, primed * rowBytes);
+		deflateSetDictionary(&stream, input - dictionary, static_cast<uInt>(dictionary));
+	}
+
+	// The bound leaves room for the empty stored block of the sync flush
+	chunk.data.resize(deflateBound(&stream, static_cast<uLong>(inputBytes)) + 16);
+	stream.next_in   = const_cast<Bytef*>(input);
+	stream.avail_in  = static_cast<uInt>(inputBytes);
+	stream.next_out  = chunk.data.data();
+	stream.avail_out = static_cast<uInt>(chunk.data.size());
+
+	const int result = deflate(&stream, finish ? Z_FINISH : Z_SYNC_FLUSH);
+	chunk.ok         = (finish ? result == Z_STREAM_END : result == Z_OK) && stream.avail_in == 0;
+	chunk.data.resize(stream.total_out);
+	deflateEnd(&stream);
+
+	chunk.adler  = adler32(1, input, static_cast<uInt>(inputBytes));
+	chunk.length = inputBytes;
+}
+
+void putU32BE(uint8_t* out, const uint32_t value)
+{
+	for (int i = 0; i < 4; i++) out[i] = static_cast<uint8_t>(value >> (24 - 8 * i));
+}
+
+/* Append a PNG chunk of 'type' with its length and CRC. */
+void writeChunk(std::ofstream& file, const char (&type)[5], const uint8_t* data, const size_t bytes)
+{
+	uint8_t header[8];
+	putU32BE(header, static_cast<uint32_t>(bytes));
+	std::copy(type, type + 4, header + 4);
+
+	// crc32 restarts on a null buffer, IEND has no data
+	uLong crc = crc32(0, header + 4, 4);
+	if (bytes > 0) crc = crc32(crc, data, static_cast<uInt>(bytes));
+
+	uint8_t trailer[4];
+	putU32BE(trailer, static_cast<uint32_t>(crc));
+
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+	file.write(reinterpret_cast<const char*>(trailer), sizeof(trailer));
+}
+
+}
+
+bool parsePngPreset(const std::string_view text, PngPreset& preset)
+{
+	if (text == "fast") preset = PngPreset::Fast;
+	else if (text == "balanced") preset = PngPreset::Balanced;
+	else if (text == "small") preset = PngPreset::Small;
+	else return false;
+	return true;
+}
+
+bool writePng(const std::string& path, const PixelBuffer& pixels, const PngPreset preset, const unsigned int threads)
+{
+	const PresetSettings settings   = presetSettings(preset);
+	const size_t         rowBytes   = pixels.stride() + 1;
+	const auto           chunkRows  = static_cast<uint32_t>(std::max<size_t>(1, settings.chunkBytes / rowBytes));
+	const size_t         chunkCount = (pixels.height() + chunkRows - 1) / chunkRows;
+
+	std::vector<DeflatedChunk> chunks(chunkCount);
+	parallelFor(chunkCount, threads, [&](const size_t i) {
+		TraceScope trace("deflate chunk", static_cast<int64_t>(i));
+		const auto first = static_cast<uint32_t>(i * chunkRows);
+		deflateRows(pixels, first, std::min(first + chunkRows, pixels.height()), settings, chunks[i]);
+	});
+	if (chunks.empty() || std::any_of(chunks.begin(), chunks.end(), [](const DeflatedChunk& chunk) { return !chunk.ok; })) return false;
+
+	// The zlib header goes before the first chunk and the Adler-32 of the whole stream after the last one
+	const uint8_t compressionMethod = 0x78;			// deflate with a 32 KB window
+	const uint8_t levelFlag         = settings.level <= 1 ? 0 : settings.level < 6 ? 1 : settings.level == 6 ? 2 : 3;
+	uint8_t       flags             = static_cast<uint8_t>(levelFlag << 6);
+	flags                           = static_cast<uint8_t>(flags + 31 - (compressionMethod * 256 + flags) % 31);
+	chunks.front().data.insert(chunks.front().data.begin(), {compressionMethod, flags});
+
+	uLong adler = adler32(0, nullptr, 0);
+	for (const auto& chunk : chunks) adler = adler32_combine(adler, chunk.adler, static_cast<z_off_t>(chunk.length));
+	uint8_t adlerBytes[4];
+	putU32BE(adlerBytes, static_cast<uint32_t>(adler));
+	chunks.back().data.insert(chunks.back().data.end(), adlerBytes, adlerBytes + 4);
+
+	uint8_t header[13] = {};
+	putU32BE(header, pixels.width());
+	putU32BE(header + 4, pixels.height());
+	header[8] = 8;					// bits per channel
+	header[9] = PNG_COLOR_RGBA;		// compression, filter and interlace methods stay 0
+
+	const std::string temporary = temporaryPath(path);
+	std::ofstream     file(temporary, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) return false;
+
+	// Every chunk of the stream is an IDAT of its own, the decoders read them as one stream
+	file.write(reinterpret_cast<const char*>(PNG_SIGNATURE), sizeof(PNG_SIGNATURE));
+	writeChunk(file, "IHDR", header, sizeof(header));
+	for (const auto& chunk : chunks) writeChunk(file, "IDAT", chunk.data.data(), chunk.data.size());
+	writeChunk(file, "IEND", nullptr, 0);
+
+	file.close();
+	if (file.fail()) {
+		discardFile(temporary);
+		return false;
+	}
+	return commitFile(temporary, path);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include "PixelPool.h"
+
+// Trade between the time spent encoding the PNG pages and their size
+enum class PngPreset {
+	Fast,			// deflate level 1, every row filtered with Sub
+	Balanced,		// deflate level 6, the best filter of every row
+	Small			// deflate level 9, the best filter of every row and larger chunks
+};
+
+/* Parse "fast", "balanced" or "small", return false for anything else. */
+bool parsePngPreset(std::string_view text, PngPreset& preset);
+
+/*
+   Write 'pixels' to the 8-bit RGBA PNG file 'path', replacing it with a single rename.
+   The rows are split in chunks that up to 'threads' workers filter and deflate on their own: every chunk is primed with the last
+   32 KB of the rows before it and ends with a sync flush, so the chunks put end to end form a single zlib stream and the file is a
+   standard PNG, barely larger than with one thread. Each row takes the filter with the smallest sum of absolute differences,
+   chosen in the same pass that deflates the chunk.
+*/
+bool writePng(const std::string& path, const PixelBuffer& pixels, PngPreset preset, unsigned int threads);
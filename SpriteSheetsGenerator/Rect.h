@@ -9,6 +9,11 @@
 #include <cstdlib>
 #include <vector>
 
+#ifdef RBP_PACK_STATS
+#include <chrono>
+#include <cstdint>
+#endif
+
 #ifdef _DEBUG
 /// debug_assert is an assert that also requires debug mode to be defined.
 #define debug_assert(x) assert(x)
@@ -16,6 +21,13 @@
 #define debug_assert(x)
 #endif
 
+#ifdef RBP_PACK_STATS
+/// pack_stats counts the work of a packer, the statement is only compiled when RBP_PACK_STATS is defined.
+#define pack_stats(statement) statement
+#else
+#define pack_stats(statement)
+#endif
+
 //using namespace std;
 
 namespace rbp {
@@ -34,6 +46,42 @@ struct Rect
 	int height{};
 };
 
+#ifdef RBP_PACK_STATS
+/// Counts the work of a packer, to tune the bin sizes and the heuristics. The counters only exist when RBP_PACK_STATS is
+/// defined for the whole program, otherwise the packers do not pay for them. Every packer maps its own structure onto
+/// these fields: the free rectangles are the skyline levels of SkylineBinPack and the shelves of ShelfBinPack.
+struct PackStats
+{
+	uint64_t inserts = 0; ///< Rectangles placed.
+	uint64_t insertNanoseconds = 0; ///< Time spent in insert, placements that fail included.
+	uint64_t scores = 0; ///< Placements scored.
+	uint64_t scoredFreeRects = 0; ///< Free rectangles tried while scoring.
+	uint64_t freeRectsHighWater = 0; ///< Most free rectangles held at once.
+	uint64_t splitCalls = 0; ///< Attempts to split a free rectangle around a placement, splitFreeNode in MaxRectsBinPack.
+	uint64_t splitRects = 0; ///< Free rectangles produced by the splits.
+	uint64_t pruneTests = 0; ///< Pairs of free rectangles tested for containment or merging.
+	uint64_t pruneRemovals = 0; ///< Free rectangles removed by the pruning or the merging.
+
+	/// Adds the work of another packer, the high water mark is the highest of the two.
+	PackStats &operator+=(const PackStats &other);
+};
+
+/// Adds the time between its construction and its destruction to a counter of nanoseconds.
+class PackTimer
+{
+public:
+	explicit PackTimer(uint64_t &nanoseconds) : total(nanoseconds), start(std::chrono::steady_clock::now()) {}
+	~PackTimer() { total += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()); }
+
+	PackTimer(const PackTimer &) = delete;
+	PackTimer &operator=(const PackTimer &) = delete;
+
+private:
+	uint64_t &total;
+	std::chrono::steady_clock::time_point start;
+};
+#endif
+
 /// Performs a lexicographic compare on (rect short side, rect long side).
 /// @return -1 if the smaller side of a is shorter than the smaller side of b, 1 if the other way around.
 ///   If they are equal, the larger side length is used as a tie-breaker.
@@ -0,0 +1,617 @@
+#include "SheetBuilder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include "AlphaFilters.h"
+#include "AtlasWriter.h"
+#include "AtomicFile.h"
+#include "BlockCompression.h"
+#include "ChannelPacking.h"
+#include "Compositor.h"
+#include "FileReader.h"
+#include "HeaderWriter.h"
+#include "Mipmaps.h"
+#include "Optimizer.h"
+#include "PackedPixels.h"
+#include "PngReader.h"
+#include "PngWriter.h"
+#include "Parallel.h"
+#include "SheetWriter.h"
+#include "SpriteCatalog.h"
+#include "TextureWriter.h"
+#include "Trace.h"
+
+namespace {
+
+/*
+   The next function chooseBestHeuristic try every heuristics for the algorithm and pick the best one by comparing the layouts.
+   The heuristics are tried in parallel, ties go to the first heuristic of the list so the result does not depend on the threads.
+*/
+Layout chooseBestHeuristic(const std::vector<rbp::RectSize>& sizes, const int texWidth, const int texHeight, const unsigned int threads)
+{
+	std::vector<rbp::MaxRectsBinPack::FreeRectChoiceHeuristic> listHeuristics;
+	listHeuristics.push_back(rbp::MaxRectsBinPack::RectBestAreaFit);
+	listHeuristics.push_back(rbp::MaxRectsBinPack::RectBestLongSideFit);
+	listHeuristics.push_back(rbp::MaxRectsBinPack::RectBestShortSideFit);
+	listHeuristics.push_back(rbp::MaxRectsBinPack::RectBottomLeftRule);
+	listHeuristics.push_back(rbp::MaxRectsBinPack::RectContactPointRule);
+
+	const std::vector<uint32_t> order = identityOrder(sizes.size());
+	std::vector<Layout>         layouts(listHeuristics.size());
+
+	parallelFor(listHeuristics.size(), threads, [&](const size_t i) {
+		TraceScope trace("pack heuristic", static_cast<int64_t>(i));
+		layouts[i] = packLayout(sizes, order, {}, listHeuristics[i], texWidth, texHeight);
+	});
+
+	size_t best = 0;
+	double min  = layoutCost(layouts[0], texWidth, texHeight);
+
+	for (size_t i = 1; i < layouts.size(); i++) {
+		if (const double cost = layoutCost(layouts[i], texWidth, texHeight); cost < min) {
+			min  = cost;
+			best = i;
+		}
+	}
+#ifdef RBP_PACK_STATS
+	for (size_t i = 0; i < layouts.size(); i++) {
+		if (i != best) layouts[best].searchStats += layouts[i].stats;
+	}
+#endif
+	return layouts[best];
+}
+
+/* Container of the GPU textures of the pages, DDS if only the texture format is given, KTX2 for ETC2 that DDS cannot hold. */
+TextureContainer pageContainer(const Options& options)
+{
+	if (options.container == TextureContainer::None && options.textureFormat == TextureFormat::Etc2) return TextureContainer::Ktx2;
+	if (options.container == TextureContainer::None && options.textureFormat != TextureFormat::Rgba8) return TextureContainer::Dds;
+	return options.container;
+}
+
+/* Video memory of one page with its mip levels, in the texture format. */
+size_t pageVideoMemory(const Options& options)
+{
+	const uint32_t levels = options.mipmaps ? mipLevelCount(options.pageWidth, options.pageHeight) : 1;
+	uint32_t       width  = options.pageWidth;
+	uint32_t       height = options.pageHeight;
+	size_t         bytes  = 0;
+	for (uint32_t level = 0; level < levels; level++) {
+		bytes += textureSize(options.textureFormat, width, height);
+		width  = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+	}
+	return bytes;
+}
+
+/* Choose the best heuristic then optimize, for sprites that all use whole pixels or that are all masks. */
+Layout packSprites(const std::vector<rbp::RectSize>& sizes, const Options& options, const unsigned int threads)
+{
+	// The packer places the sprites with their border, the padding of the last column and row falls outside of the page.
+	// To keep the sprites apart in the mip levels and the compressed blocks the page is packed in cells of the isolation
+	// granularity, at least a block.
+	const int                        cell      = std::max(1 << options.mipIsolation, isBlockCompressed(options.textureFormat) ? 4 : 1);
+	const std::vector<rbp::RectSize> inflated  = inflateSizes(sizes, static_cast<int>(options.padding), static_cast<int>(options.extrude));
+	const std::vector<rbp::RectSize> packed    = cell > 1 ? toCellSizes(inflated, cell) : inflated;
+	const int                        texWidth  = static_cast<int>(options.pageWidth + options.padding) / cell;
+	const int                        texHeight = static_cast<int>(options.pageHeight + options.padding) / cell;
+	Layout                           layout    = chooseBestHeuristic(packed, texWidth, texHeight, threads);
+
+	// Search a better insertion order and rotation allowance until the budget expires
+	if (options.optimizeMs > 0 || options.optimizeIterations > 0) {
+		OptimizerSettings settings;
+		settings.budgetMs   = options.optimizeMs;
+		settings.iterations = options.optimizeIterations;
+		settings.threads    = threads;
+
+		TraceScope trace("optimize layout");
+		layout = optimizeLayout(packed, layout, texWidth, texHeight, settings);
+	}
+
+	if (cell > 1) fromCellLayout(layout, inflated, cell);
+	return layout;
+}
+
+// One set of images drawn with the layout of the sheet: the sprites themselves or one of their companion maps
+struct SheetMap {
+	std::string                     filename;		// filename of the pages, without extension
+	std::vector<const PixelBuffer*> pixels;			// decoded image of every sprite, null if it is decoded from its file or missing
+	std::vector<std::string>        files;			// path of every image decoded straight into the pages, empty if it is not
+	std::vector<uintmax_t>          fileBytes;		// size of every file of 'files', for the reader
+	bool                            colors = true;	// the sprites themselves: alpha mode and sRGB filtering of the mip levels
+};
+
+/* Read the size of an image, from the header of a PNG file or by decoding any other format. */
+bool readImageSize(const std::string& path, uint32_t& width, uint32_t& height)
+{
+	if (readPngSize(path, width, height)) return true;
+
+	sf::Image decoded;
+	if (!decoded.loadFromFile(path)) return false;
+	width  = decoded.getSize().x;
+	height = decoded.getSize().y;
+	return true;
+}
+
+/*
+   Decode the image file 'path', read in 'bytes', into the rectangle of 'placement' in 'page'. PNG files are decoded row by row straight
+   into the page, the other formats through SFML and a buffer of the pool.
+*/
+bool decodeSprite(const std::string& path, const std::vector<uint8_t>& bytes, PixelBuffer& page, const Placement& placement, PixelPool& pool)
+{
+	TraceScope trace("decode", path);
+	if (decodePng(bytes.data(), bytes.size(), page, placement)) return true;
+
+	sf::Image decoded;
+	if (bytes.empty() || !decoded.loadFromMemory(bytes.data(), bytes.size())) return false;
+
+	const auto width  = static_cast<uint32_t>(placement.rotated ? placement.rect.height : placement.rect.width);
+	const auto height = static_cast<uint32_t>(placement.rotated ? placement.rect.width : placement.rect.height);
+	if (decoded.getSize().x != width || decoded.getSize().y != height) return false;
+
+	PixelBuffer pixels = pool.acquire(width, height);
+	if (!pixels) return false;
+	std::memcpy(pixels.data(), decoded.getPixelsPtr(), pixels.bytes());
+	blitSprite(pixels, page, placement);
+	return true;
+}
+
+/*
+   The files of a companion map, checked in parallel from their headers, with the size of every file in 'fileBytes'. The images must
+   have the size of the sprites, the missing ones are left empty and drawn transparent.
+*/
+std::vector<std::string> findCompanion(const std::vector<std::string>& names, const std::vector<rbp::RectSize>& sizes, const std::string& folder,
+                                       const unsigned int threads, std::vector<uintmax_t>& fileBytes, std::ostream& log)
+{
+	std::vector<std::string> files(names.size());
+	std::vector<std::string> messages(names.size());		// printed in order once every file is checked
+	fileBytes.assign(names.size(), 0);
+
+	parallelFor(names.size(), threads, [&](const size_t i) {
+		const std::string path = folder + "/" + names[i];
+		TraceScope        trace("read size", path);
+		std::error_code   error;
+		const uintmax_t   bytes = std::filesystem::file_size(path, error);
+		uint32_t          width, height;
+		if (error || !readImageSize(path, width, height)) {
+			messages[i] = "Warning: " + path + " is missing, drawn transparent\n";
+			return;
+		}
+		if (width != static_cast<uint32_t>(sizes[i].width) || height != static_cast<uint32_t>(sizes[i].height)) {
+			messages[i] = "Error: " + path + " does not have the size of " + names[i] + "\n";
+			return;
+		}
+		files[i]     = path;
+		fileBytes[i] = bytes;
+	});
+
+	for (const auto& message : messages) log << message;
+	return files;
+}
+
+/*
+   Render the pages of one map of the sheet and write them with their mip levels and GPU textures.
+   'firstPage' receives the first page if it is not null. Return false if the pixel limit is reached.
+*/
+bool renderMap(const SheetMap& map, const Layout& layout, const Options& options, const unsigned int threads, PixelPool& pool, std::ostream& log,
+               sf::Image* firstPage)
+{
+	const std::string& filename = map.filename;
+	const std::string  folder   = options.output + "/";
+
+	for (size_t page = 0; page < layout.pages; page++) {
+		TraceScope pageTrace("render page", filename, static_cast<int64_t>(page));
+
+		// Every page has the same size so they all reuse the same slab of the pool
+		PixelBuffer pagePixels = pool.acquire(options.pageWidth, options.pageHeight);
+		if (!pagePixels) {
+			log << "Error: the pixel limit is reached while rendering page " << page << "\n";
+			return false;
+		}
+		clearPage(pagePixels);
+
+		std::vector<Placement> spritePlacements;	// sprites of this page, for the filters
+		std::vector<size_t>    spriteIndices;		// index of every one of them in the layout
+		bool                   maskPage = false;	// the channels of the page are masks
+
+		for (size_t i = 0; i < map.pixels.size(); i++) {
+			if (layout.placements[i].page != static_cast<int>(page) || (!map.pixels[i] && map.files[i].empty())) continue;
+
+			// The pixels use the rectangle of the sprite, without its border
+			Placement placement = layout.placements[i];
+			placement.rect      = innerRect(placement.rect, static_cast<int>(options.padding), static_cast<int>(options.extrude));
+			spritePlacements.push_back(placement);
+			spriteIndices.push_back(i);
+			maskPage |= placement.channel >= 0;
+		}
+
+		// The rectangles never overlap, or only in different channels, so the sprites are drawn in parallel without locks, each worker
+		// writing a band of the page.
+		const std::vector<std::vector<size_t>> parts = partitionPlacements(spritePlacements, pagePixels, threads);
+		std::vector<char>                      drawn(spritePlacements.size(), 1);
+		parallelFor(parts.size(), threads, [&](const size_t part) {
+			TraceScope trace("draw sprites", static_cast<int64_t>(part));
+			for (const size_t k : parts[part]) {
+				const Placement&   placement = spritePlacements[k];
+				const PixelBuffer* pixels    = map.pixels[spriteIndices[k]];
+				if (!pixels) continue;		// decoded from its file below
+
+				// copy the sprite on the sprite sheet, or its single channel in the channel of its placement
+				if (placement.channel >= 0) blitChannel(*pixels, maskChannel(*pixels), pagePixels, placement);
+				else blitSprite(*pixels, pagePixels, placement);
+			}
+		});
+
+		// Sprites without pixels are decoded from their files straight into their rectangles, the reads of the next files overlap the decoding
+		std::vector<size_t>      decodedSprites;		// index of every one of them in spritePlacements
+		std::vector<std::string> paths;
+		std::vector<uintmax_t>   fileBytes;
+		for (size_t k = 0; k < spritePlacements.size(); k++) {
+			if (map.pixels[spriteIndices[k]]) continue;
+			decodedSprites.push_back(k);
+			paths.push_back(map.files[spriteIndices[k]]);
+			fileBytes.push_back(map.fileBytes[spriteIndices[k]]);
+		}
+		if (!paths.empty()) {
+			readFiles(paths, fileBytes, threads, [&](const size_t j, const std::vector<uint8_t>& bytes) {
+				const size_t k = decodedSprites[j];
+				drawn[k]       = decodeSprite(paths[j], bytes, pagePixels, spritePlacements[k], pool);
+			});
+		}
+
+		// Clear what a failed decode left behind
+		for (size_t k = 0; k < spritePlacements.size(); k++) {
+			if (drawn[k]) continue;
+			const rbp::Rect& rect = spritePlacements[k].rect;
+			log << "Error: cannot decode " << map.files[spriteIndices[k]] << "\n";
+			for (int y = 0; y < rect.height; y++) {
+				std::memset(pagePixels.row(static_cast<uint32_t>(rect.y + y)) + static_cast<size_t>(rect.x) * 4, 0, static_cast<size_t>(rect.width) * 4);
+			}
+		}
+
+		// The sprites and their borders never overlap in a channel so they are filtered in parallel, the border copies the filtered edge.
+		// Masks and companion maps are not the colors of the sprites, they keep their values.
+		parallelFor(spritePlacements.size(), threads, [&](const size_t i) {
+			TraceScope       trace("filter sprite", static_cast<int64_t>(i));
+			const Placement& placement = spritePlacements[i];
+			if (placement.channel >= 0) {
+				extrudeChannel(pagePixels, placement.rect, static_cast<int>(options.extrude), placement.channel);
+				return;
+			}
+			if (map.colors) applyAlphaMode(pagePixels, placement.rect, options.alpha);
+			extrudeEdges(pagePixels, placement.rect, static_cast<int>(options.extrude));
+		});
+
+		// Save the page of the sprite sheet
+		const std::string path = folder + getPageFilename(filename, page) + ".png";
+		if (TraceScope trace("encode png", path); !writePng(path, pagePixels, options.png, threads)) {
+			log << "Error: cannot write " << path << "\n";
+		}
+
+		if (page == 0 && firstPage) firstPage->create(options.pageWidth, options.pageHeight, pagePixels.data());
+
+		// Stream the page and its mip levels to the GPU texture, each level is encoded and written as soon as it is filtered
+		const TextureContainer container = pageContainer(options);
+		const uint32_t         levels    = options.mipmaps ? mipLevelCount(options.pageWidth, options.pageHeight) : 1;
+		const std::string      texPath   = folder + getPageFilename(filename, page) + textureContainerExtension(container);
+		TextureWriter          texture;
+		std::vector<uint8_t>   texels;		// encoded level, reused by every level
+		bool                   texOk     = container == TextureContainer::None
+		                  || texture.open(texPath, container, options.textureFormat, options.pageWidth, options.pageHeight, levels,
+		                                  map.colors && options.alpha == AlphaMode::Premultiply, options.supercompress);
+
+		auto writeTextureLevel = [&](const PixelBuffer& pixels) {
+			if (container == TextureContainer::None || !texOk) return;
+			TraceScope trace("encode texture level", texPath);
+			if (options.textureFormat == TextureFormat::Rgba8) {
+				texOk = texture.writeLevel(pixels.data(), pixels.bytes());
+				return;
+			}
+			if (isBlockCompressed(options.textureFormat)) compressPixels(pixels, options.textureFormat, texels, threads);
+			else packPixels(pixels, options.textureFormat, options.dither, texels, threads);
+			texOk = texture.writeLevel(texels.data(), texels.size());
+		};
+		writeTextureLevel(pagePixels);
+
+		// Save the mip chain, each level filtered from the one above
+		if (options.mipmaps) {
+			const MipContent mipContent = maskPage || !map.colors                 ? MipContent::Data
+			                              : options.alpha == AlphaMode::Premultiply ? MipContent::Premultiplied
+			                                                                        : MipContent::Straight;
+			PixelBuffer      above      = std::move(pagePixels);
+			for (uint32_t level = 1; level < levels; level++) {
+				PixelBuffer mip = pool.acquire(std::max(1u, above.width() / 2), std::max(1u, above.height() / 2));
+				if (!mip) {
+					log << "Error: the pixel limit is reached while rendering mip level " << level << " of page " << page << "\n";
+					return false;
+				}
+				{
+					TraceScope trace("downsample", static_cast<int64_t>(level));
+					downsample(above, mip, mipContent, threads);
+				}
+
+				const std::string mipPath = folder + getPageFilename(filename, page) + "_mip" + std::to_string(level) + ".png";
+				if (TraceScope trace("encode png", mipPath); !writePng(mipPath, mip, options.png, threads)) {
+					log << "Error: cannot write " << mipPath << "\n";
+				}
+				writeTextureLevel(mip);
+				above = std::move(mip);
+			}
+		}
+
+		// The texture is closed even after a failed level so that its temporary file is deleted
+		if (container != TextureContainer::None && !(texture.close() && texOk)) {
+			log << "Error: cannot write " << texPath << "\n";
+		}
+	}
+	return true;
+}
+
+/*
+   Render the pages of the sprites and of their companion maps and write them with the metadata of the sheet.
+   'names' and 'sizes' are the path and the size of every image in the order of the layout, 'sprites' holds their pixels or files.
+*/
+bool renderSheet(const std::vector<std::string>& names, const std::vector<rbp::RectSize>& sizes, SheetMap&& sprites, const Layout& layout,
+                 const Options& options, PixelPool& pool, std::ostream& log, sf::Texture* preview)
+{
+	TraceScope trace("build sheet");
+
+	const std::string& filename = options.name;		// filename of the sprite sheet
+	const std::string  folder   = options.output + "/";
+
+	std::vector<std::string> imgTexID;		// name of the images
+	SpriteCatalog            catalog;		// metadata of the sprites for the xml file
+
+	for (const auto& file : names) imgTexID.push_back(file.substr(0, file.rfind('.')));
+
+	log << "layout : " << layout.pages << " page(s), hash " << std::hex << hashLayout(layout) << std::dec << "\n";
+
+	// The catalog stores the page of a sprite in 16 bits
+	if (layout.pages > UINT16_MAX + 1u) {
+		log << "Error: " << layout.pages << " pages, a sheet has at most " << UINT16_MAX + 1u << "\n";
+		return false;
+	}
+
+	catalog.setFilename(filename + ".png");
+	catalog.reserve(names.size());
+
+	for (size_t i = 0; i < names.size(); i++) {
+		if (layout.placements[i].page < 0) {
+			log << "Error: " << imgTexID[i] << " does not fit in a page\n";
+		}
+	}
+
+	// Save data of the images for the xml file, page after page
+	for (size_t page = 0; page < layout.pages; page++) {
+		for (size_t i = 0; i < names.size(); i++) {
+			if (layout.placements[i].page != static_cast<int>(page)) continue;
+
+			// The metadata uses the rectangle of the sprite, without its border
+			const Placement& placement  = layout.placements[i];
+			const rbp::Rect  packedRect = innerRect(placement.rect, static_cast<int>(options.padding), static_cast<int>(options.extrude));
+			const size_t     rotation   = placement.rotated ? 90 : 0;	// rotation for the xml data
+
+			const uint32_t index = catalog.add(imgTexID[i], packedRect.x, packedRect.y, packedRect.width, packedRect.height, static_cast<uint32_t>(rotation), static_cast<uint32_t>(page));
+			if (placement.channel >= 0) catalog.setChannel(index, static_cast<uint32_t>(placement.channel + 1));
+		}
+	}
+
+	// The sprites and every companion map share the layout, the maps are decoded and rendered at the same time
+	std::vector<SheetMap>           maps(1 + options.maps.size());
+	std::vector<std::ostringstream> logs(maps.size());		// printed in the order of the maps
+	std::vector<char>               rendered(maps.size(), 0);
+	const unsigned int              mapThreads = std::max(1u, workerThreads(options) / static_cast<unsigned int>(maps.size()));
+	sf::Image                       firstPage;
+
+	maps[0]          = std::move(sprites);
+	maps[0].filename = filename;
+	for (size_t m = 0; m < options.maps.size(); m++) {
+		maps[m + 1].filename = filename + "_" + options.maps[m].name;
+		maps[m + 1].pixels.assign(names.size(), nullptr);
+		maps[m + 1].colors   = false;
+	}
+
+	parallelFor(maps.size(), workerThreads(options), [&](const size_t m) {
+		TraceScope trace("render map", maps[m].filename);
+		if (m > 0) maps[m].files = findCompanion(names, sizes, options.maps[m - 1].folder, mapThreads, maps[m].fileBytes, logs[m]);
+		rendered[m] = renderMap(maps[m], layout, options, mapThreads, pool, logs[m], m == 0 && preview ? &firstPage : nullptr);
+	});
+
+	for (const auto& mapLog : logs) log << mapLog.str();
+	if (std::find(rendered.begin(), rendered.end(), 0) != rendered.end()) return false;
+	if (preview && layout.pages > 0) preview->loadFromImage(firstPage);
+
+	// Save the metadata of the sheet in every requested format
+	TraceScope  metadataTrace("write metadata");
+	SheetWriter writer;
+	for (const SheetFormat format : options.formats) {
+		const std::string path = folder + filename + sheetFormatExtension(format);
+		if (!writeSheet(writer, path, format, catalog)) {
+			log << "Error: cannot write " << path << "\n";
+		}
+	}
+
+	// Save the C++ header of the sprites, untouched if the layout did not change
+	if (!options.header.empty() && !writeSpriteHeader(options.header, catalog)) {
+		log << "Error: cannot write " << options.header << "\n";
+	}
+
+	// Save the binary sheet
+	if (options.binary && !writeAtlasBinary(folder + filename + ".atlas", catalog, log)) {
+		log << "Error: cannot write " << folder << filename << ".atlas\n";
+	}
+
+	// See the occupancy of the packing
+	log << "pack1 : " << layout.occupancy << "%\n";
+#ifdef RBP_PACK_STATS
+	log << "pack stats : {\"layout\":";
+	writePackStats(log, layout.stats);
+	log << ",\"search\":";
+	writePackStats(log, layout.searchStats);
+	log << "}\n";
+#endif
+	log << "vram : " << (pageVideoMemory(options) >> 10) << "KB per page\n";
+	log << "pixels : " << (pool.highWater() >> 20) << "MB high water, " << (pool.held() >> 20) << "MB held\n";
+	return true;
+}
+
+}
+
+Layout computeLayout(const std::vector<rbp::RectSize>& sizes, const std::vector<char>& masks, const Options& options, const unsigned int threads)
+{
+	TraceScope trace("compute layout");
+	if (std::find(masks.begin(), masks.end(), 1) == masks.end()) return packSprites(sizes, options, threads);
+
+	// The masks are packed on their own, four pages of masks make one page of the sheet with a mask page in every channel
+	std::vector<rbp::RectSize> colorSizes, maskSizes;
+	std::vector<size_t>        colorIndices, maskIndices;
+	for (size_t i = 0; i < sizes.size(); i++) {
+		(masks[i] ? maskSizes : colorSizes).push_back(sizes[i]);
+		(masks[i] ? maskIndices : colorIndices).push_back(i);
+	}
+	const Layout colors = colorSizes.empty() ? Layout{} : packSprites(colorSizes, options, threads);
+	const Layout layers = packSprites(maskSizes, options, threads);
+
+	Layout layout = colors;
+	layout.placements.assign(sizes.size(), Placement{});
+	for (size_t i = 0; i < colorIndices.size(); i++) layout.placements[colorIndices[i]] = colors.placements[i];
+	for (size_t i = 0; i < maskIndices.size(); i++) {
+		Placement placement = layers.placements[i];
+		if (placement.page >= 0) {
+			placement.channel = placement.page % 4;
+			placement.page    = static_cast<int>(colors.pages) + placement.page / 4;
+		}
+		layout.placements[maskIndices[i]] = placement;
+	}
+
+	layout.pages     = colors.pages + (layers.pages + 3) / 4;
+	layout.unplaced  = colors.unplaced + layers.unplaced;
+#ifdef RBP_PACK_STATS
+	layout.stats += layers.stats;
+	layout.searchStats += layers.searchStats;
+#endif
+	layout.occupancy = layout.pages == 0 ? 0.0f : (colors.occupancy * colors.pages + layers.occupancy * layers.pages / 4) / layout.pages;
+	return layout;
+}
+
+std::string getPageFilename(const std::string& filename, const size_t page)
+{
+	return page == 0 ? filename : filename + std::to_string(page);
+}
+
+bool loadImages(const std::string& directory, const std::vector<ScannedFile>& scanned, PixelPool& pool, ImageCache& images, const unsigned int threads,
+                std::ostream& log)
+{
+	std::vector<std::string> paths;
+	std::vector<uintmax_t>   sizes;
+	for (const auto& file : scanned) {
+		images.erase(file.path);		// give the old pixels back to the pool first
+		paths.push_back(directory + "/" + file.path);
+		sizes.push_back(file.size);
+	}
+
+	// The files are decoded by the workers while the next ones are being read
+	std::vector<std::shared_ptr<const PixelBuffer>> decoded(scanned.size());
+	std::atomic<bool>                               full{false};
+	readFiles(paths, sizes, threads, [&](const size_t i, const std::vector<uint8_t>& bytes) {
+		TraceScope trace("decode", paths[i]);
+		sf::Image  image;
+		if (full || bytes.empty() || !image.loadFromMemory(bytes.data(), bytes.size())) return;
+
+		PixelBuffer pixels = pool.acquire(image.getSize().x, image.getSize().y);
+		if (!pixels) {
+			full = true;
+			return;
+		}
+		std::memcpy(pixels.data(), image.getPixelsPtr(), pixels.bytes());
+		decoded[i] = std::make_shared<const PixelBuffer>(std::move(pixels));
+	});
+
+	if (full) {
+		log << "Error: the pixel limit is reached while loading the images\n";
+		return false;
+	}
+	for (size_t i = 0; i < scanned.size(); i++) {
+		if (decoded[i]) images.emplace(scanned[i].path, std::move(decoded[i]));
+	}
+	return true;
+}
+
+std::vector<char> getMaskImages(const ImageCache& images, const Options& options)
+{
+	std::vector<char> masks;
+	if (!options.channelPack) return masks;
+
+	std::vector<const PixelBuffer*> pixels;
+	for (const auto& [file, image] : images) pixels.push_back(image.get());
+
+	masks.resize(pixels.size());
+	parallelFor(pixels.size(), workerThreads(options), [&](const size_t i) {
+		masks[i] = maskChannel(*pixels[i]) >= 0 ? 1 : 0;
+	});
+	return masks;
+}
+
+std::vector<rbp::RectSize> getImageSizes(const ImageCache& images)
+{
+	std::vector<rbp::RectSize> sizes;
+	sizes.reserve(images.size());
+	for (const auto& [file, pixels] : images) sizes.push_back({static_cast<int>(pixels->width()), static_cast<int>(pixels->height())});
+	return sizes;
+}
+
+std::vector<rbp::RectSize> getImageSizes(const ImageFiles& files)
+{
+	std::vector<rbp::RectSize> sizes;
+	sizes.reserve(files.size());
+	for (const auto& [file, image] : files) sizes.push_back(image.size);
+	return sizes;
+}
+
+ImageFiles readImageSizes(const std::string& directory, const std::vector<ScannedFile>& scanned, const unsigned int threads)
+{
+	std::vector<rbp::RectSize> sizes(scanned.size(), {0, 0});
+	parallelFor(scanned.size(), threads, [&](const size_t i) {
+		TraceScope trace("read size", scanned[i].path);
+		uint32_t width, height;
+		if (readImageSize(directory + "/" + scanned[i].path, width, height)) sizes[i] = {static_cast<int>(width), static_cast<int>(height)};
+	});
+
+	ImageFiles files;
+	for (size_t i = 0; i < scanned.size(); i++) {
+		if (sizes[i].width > 0) files.emplace(scanned[i].path, ImageFile{sizes[i], scanned[i].size});
+	}
+	return files;
+}
+
+bool buildSheet(const ImageCache& images, const Layout& layout, const Options& options, PixelPool& pool, std::ostream& log, sf::Texture* preview)
+{
+	std::vector<std::string> names;
+	SheetMap                 sprites;		// decoded images
+
+	for (const auto& [file, pixels] : images) {
+		names.push_back(file);
+		sprites.pixels.push_back(pixels.get());
+	}
+	sprites.files.resize(names.size());
+	sprites.fileBytes.resize(names.size());
+	return renderSheet(names, getImageSizes(images), std::move(sprites), layout, options, pool, log, preview);
+}
+
+bool buildSheet(const ImageFiles& files, const Layout& layout, const Options& options, PixelPool& pool, std::ostream& log, sf::Texture* preview)
+{
+	std::vector<std::string> names;
+	SheetMap                 sprites;		// files decoded straight into the pages
+
+	for (const auto& [file, image] : files) {
+		names.push_back(file);
+		sprites.files.push_back(options.input + "/" + file);
+		sprites.fileBytes.push_back(image.bytes);
+	}
+	sprites.pixels.assign(names.size(), nullptr);
+	return renderSheet(names, getImageSizes(files), std::move(sprites), layout, options, pool, log, preview);
+}
+
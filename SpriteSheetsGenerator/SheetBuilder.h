@@ -0,0 +1,66 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "FileScanner.h"
+#include "Options.h"
+#include "Packer.h"
+#include "PixelPool.h"
+
+// Decoded images by path relative to the input folder, the map keeps them sorted because the layout depends on the order.
+// The pixels are shared so that a cache can hand the same image to several builds.
+using ImageCache = std::map<std::string, std::shared_ptr<const PixelBuffer>>;
+
+// An image decoded straight into the pages instead of being cached: its size for the packer and the size of its file for the reader
+struct ImageFile {
+	rbp::RectSize size{};
+	uintmax_t     bytes = 0;
+};
+
+// Images decoded straight into the pages by path relative to the input folder
+using ImageFiles = std::map<std::string, ImageFile>;
+
+/*
+   Decode the scanned images of 'directory' into the cache on up to 'threads' workers, replacing their previous pixels. The files are read
+   with readFiles so that the reads of the next files overlap the decoding. Files that cannot be decoded are skipped.
+   Return false if the pixel limit is reached.
+*/
+bool loadImages(const std::string& directory, const std::vector<ScannedFile>& scanned, PixelPool& pool, ImageCache& images, unsigned int threads,
+                std::ostream& log);
+
+/* The size of every image for the packer, in the order of the cache. */
+std::vector<rbp::RectSize> getImageSizes(const ImageCache& images);
+std::vector<rbp::RectSize> getImageSizes(const ImageFiles& files);
+
+/* Read the size of the scanned images of 'directory' in parallel, from the header of the PNG files. Files that cannot be read are skipped. */
+ImageFiles readImageSizes(const std::string& directory, const std::vector<ScannedFile>& scanned, unsigned int threads);
+
+/* For channel packing, 1 for every image that only carries one channel, see maskChannel. Empty if the option is off. */
+std::vector<char> getMaskImages(const ImageCache& images, const Options& options);
+
+/*
+   Choose the best heuristic then let the optimizer improve the layout if it has a budget.
+   The masks flagged by getMaskImages are packed after the other sprites, on pages of their own where each channel is a layer.
+   The rectangles of the layout include the padding and the extrusion, see innerRect.
+*/
+Layout computeLayout(const std::vector<rbp::RectSize>& sizes, const std::vector<char>& masks, const Options& options, unsigned int threads);
+
+/* The filename of a page of the sprite sheet, the first page keeps the name of the sheet. */
+std::string getPageFilename(const std::string& filename, size_t page);
+
+/*
+   Render the pages of a layout of the images, and of their companion maps, and write them with the metadata of the sheet to the
+   output folder of the options, every file replaces the previous one with a single rename. 'preview' receives the first page if it is not null.
+   Return false if the pixel limit is reached.
+*/
+bool buildSheet(const ImageCache& images, const Layout& layout, const Options& options, PixelPool& pool, std::ostream& log, sf::Texture* preview);
+
+/*
+   Same as above for images that were not decoded: each one is decoded from the input folder straight into its rectangle of the page,
+   so only the pages take memory. Channel packing needs the pixels of the images before the layout and cannot use it.
+*/
+bool buildSheet(const ImageFiles& files, const Layout& layout, const Options& options, PixelPool& pool, std::ostream& log, sf::Texture* preview);
@@ -0,0 +1,244 @@
+#include "SheetWriter.h"
+
+#include <algorithm>
+#include <cstring>
+#include "AtomicFile.h"
+
+bool parseSheetFormat(const std::string_view text, SheetFormat& format)
+{
+	if (text == "xml") format = SheetFormat::Xml;
+	else if (text == "json") format = SheetFormat::Json;
+	else if (text == "csv") format = SheetFormat::Csv;
+	else return false;
+	return true;
+}
+
+const char* sheetFormatExtension(const SheetFormat format)
+{
+	switch (format) {
+		case SheetFormat::Json: return ".json";
+		case SheetFormat::Csv: return ".csv";
+		default: return ".xml";
+	}
+}
+
+SheetWriter::SheetWriter(const size_t capacity)
+	: m_buffer(std::max<size_t>(capacity, 64)) {}
+
+bool SheetWriter::open(const std::string& path)
+{
+	// Binary mode so the file is the same on every platform
+	m_used = 0;
+	m_path = path;
+	m_temporary = temporaryPath(path);
+	m_file.open(m_temporary, std::ios::binary | std::ios::trunc);
+	return m_file.is_open();
+}
+
+bool SheetWriter::close()
+{
+	flush();
+	m_file.close();
+	const bool ok = !m_file.fail();
+	m_file.clear();
+
+	if (!ok) {
+		discardFile(m_temporary);
+		return false;
+	}
+	return commitFile(m_temporary, m_path);
+}
+
+void SheetWriter::flush()
+{
+	m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_used));
+	m_used = 0;
+}
+
+void SheetWriter::write(const std::string_view text)
+{
+	reserve(text.size());
+	if (text.size() > m_buffer.size()) {
+		m_file.write(text.data(), static_cast<std::streamsize>(text.size()));
+		return;
+	}
+	std::memcpy(m_buffer.data() + m_used, text.data(), text.size());
+	m_used += text.size();
+}
+
+void SheetWriter::write(const char c)
+{
+	reserve(1);
+	m_buffer[m_used++] = c;
+}
+
+void SheetWriter::write(const uint32_t value)
+{
+	reserve(10);
+	const auto result = std::to_chars(m_buffer.data() + m_used, m_buffer.data() + m_buffer.size(), value);
+	m_used = static_cast<size_t>(result.ptr - m_buffer.data());
+}
+
+void SheetWriter::writeEscaped(const std::string_view text, const SheetFormat format)
+{
+	switch (format) {
+		case SheetFormat::Xml:
+			// Same escaping as rapidxml for a value between double quotes
+			for (const char c : text) {
+				switch (c) {
+					case '<': write("&lt;"); break;
+					case '>': write("&gt;"); break;
+					case '"': write("&quot;"); break;
+					case '&': write("&amp;"); break;
+					default: write(c);
+				}
+			}
+			break;
+
+		case SheetFormat::Json:
+			for (const char c : text) {
+				if (c == '"' || c == '\\') {
+					write('\\');
+					write(c);
+				}
+				else if (static_cast<unsigned char>(c) < 0x20) {
+					constexpr char hex[] = "0123456789abcdef";
+					write("\\u00");
+					write(hex[(c >> 4) & 0xf]);
+					write(hex[c & 0xf]);
+				}
+				else {
+					write(c);
+				}
+			}
+			break;
+
+		case SheetFormat::Csv:
+			// RFC 4180: quote the field if needed and double the quotes
+			if (text.find_first_of(",\"\r\n") == std::string_view::npos) {
+				write(text);
+				break;
+			}
+			write('"');
+			for (const char c : text) {
+				if (c == '"') write('"');
+				write(c);
+			}
+			write('"');
+			break;
+	}
+}
+
+namespace {
+
+void writeXml(SheetWriter& writer, const SpriteCatalog& sprites)
+{
+	writer.write("<TextureList Filename=\"");
+	writer.writeEscaped(sprites.getFilename(), SheetFormat::Xml);
+	writer.write("\">\n");
+
+	for (uint32_t i = 0; i < sprites.size(); i++) {
+		writer.write("\t<image name=\"");
+		writer.writeEscaped(sprites.getName(i), SheetFormat::Xml);
+		writer.write("\" x=\"");
+		writer.write(sprites.getX(i));
+		writer.write("\" y=\"");
+		writer.write(sprites.getY(i));
+		writer.write("\" w=\"");
+		writer.write(sprites.getWidth(i));
+		writer.write("\" h=\"");
+		writer.write(sprites.getHeight(i));
+		writer.write('"');
+
+		if (sprites.getRotation(i) != 0) {
+			writer.write(" rotation=\"");
+			writer.write(sprites.getRotation(i));
+			writer.write('"');
+		}
+
+		if (sprites.getPage(i) != 0) {
+			writer.write(" page=\"");
+			writer.write(sprites.getPage(i));
+			writer.write('"');
+		}
+
+		if (sprites.getChannel(i) != 0) {
+			writer.write(" channel=\"");
+			writer.write(channelName(sprites.getChannel(i)));
+			writer.write('"');
+		}
+
+		writer.write("/>\n");
+	}
+
+	writer.write("</TextureList>\n");
+}
+
+void writeJson(SheetWriter& writer, const SpriteCatalog& sprites)
+{
+	writer.write('[');
+	for (uint32_t i = 0; i < sprites.size(); i++) {
+		writer.write(i == 0 ? "\n\t{\"name\":\"" : ",\n\t{\"name\":\"");
+		writer.writeEscaped(sprites.getName(i), SheetFormat::Json);
+		writer.write("\",\"x\":");
+		writer.write(sprites.getX(i));
+		writer.write(",\"y\":");
+		writer.write(sprites.getY(i));
+		writer.write(",\"w\":");
+		writer.write(sprites.getWidth(i));
+		writer.write(",\"h\":");
+		writer.write(sprites.getHeight(i));
+		writer.write(",\"rotation\":");
+		writer.write(sprites.getRotation(i));
+		writer.write(",\"page\":");
+		writer.write(sprites.getPage(i));
+		if (sprites.getChannel(i) != 0) {
+			writer.write(",\"channel\":\"");
+			writer.write(channelName(sprites.getChannel(i)));
+			writer.write('"');
+		}
+		writer.write('}');
+	}
+	writer.write("\n]\n");
+}
+
+void writeCsv(SheetWriter& writer, const SpriteCatalog& sprites)
+{
+	// The channel column only exists for the sheets that use channel packing
+	const bool channels = sprites.hasChannels();
+	writer.write(channels ? "name,x,y,w,h,rotation,page,channel\n" : "name,x,y,w,h,rotation,page\n");
+	for (uint32_t i = 0; i < sprites.size(); i++) {
+		writer.writeEscaped(sprites.getName(i), SheetFormat::Csv);
+		writer.write(',');
+		writer.write(sprites.getX(i));
+		writer.write(',');
+		writer.write(sprites.getY(i));
+		writer.write(',');
+		writer.write(sprites.getWidth(i));
+		writer.write(',');
+		writer.write(sprites.getHeight(i));
+		writer.write(',');
+		writer.write(sprites.getRotation(i));
+		writer.write(',');
+		writer.write(sprites.getPage(i));
+		if (channels) {
+			writer.write(',');
+			writer.write(channelName(sprites.getChannel(i)));
+		}
+		writer.write('\n');
+	}
+}
+
+}
+
+bool writeSheet(SheetWriter& writer, const std::string& path, const SheetFormat format, const SpriteCatalog& sprites)
+{
+	if (!writer.open(path)) return false;
+
+	switch (format) {
+		case SheetFormat::Xml: writeXml(writer, sprites); break;
+		case SheetFormat::Json: writeJson(writer, sprites); break;
+		case SheetFormat::Csv: writeCsv(writer, sprites); break;
+	}
+	return writer.close();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <charconv>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "SpriteCatalog.h"
+
+// Text formats of the sheet metadata
+enum class SheetFormat {
+	Xml,
+	Json,
+	Csv
+};
+
+/* Parse "xml", "json" or "csv", return false for anything else. */
+bool parseSheetFormat(std::string_view text, SheetFormat& format);
+
+/* The file extension of a format, with the dot. */
+const char* sheetFormatExtension(SheetFormat format);
+
+// Buffered writer that formats numbers with std::to_chars and flushes straight to the file, the buffer is kept between files
+class SheetWriter {
+public:
+	explicit SheetWriter(size_t capacity = 1 << 16);
+
+	/* The file is written to a temporary path and only replaces 'path' when it is closed without error. */
+	bool open(const std::string& path);
+	bool close();
+
+	void write(std::string_view text);
+	void write(char c);
+	void write(uint32_t value);
+	void writeEscaped(std::string_view text, SheetFormat format);
+
+private:
+	void flush();
+
+	/* Make room for 'count' more characters. */
+	void reserve(const size_t count)
+	{
+		if (m_used + count > m_buffer.size()) flush();
+	}
+
+	std::vector<char> m_buffer;
+	size_t            m_used = 0;
+	std::ofstream     m_file;
+	std::string       m_path;
+	std::string       m_temporary;		// written until close renames it over m_path
+};
+
+/*
+   Write the metadata of every sprite to 'path' in the given format.
+   The xml document keeps the layout of the TextureList files written by the previous versions.
+*/
+bool writeSheet(SheetWriter& writer, const std::string& path, SheetFormat format, const SpriteCatalog& sprites);
@@ -0,0 +1,73 @@
+#include "SpriteCatalog.h"
+
+#include <algorithm>
+#include <cassert>
+
+void SpriteCatalog::reserve(const size_t count, const size_t nameBytes)
+{
+	m_names.reserve(nameBytes);
+	m_nameOffsets.reserve(count + 1);
+	for (auto* column : {&m_x, &m_y, &m_width, &m_height, &m_rotation, &m_page, &m_trimX, &m_trimY, &m_sourceWidth, &m_sourceHeight, &m_channel}) {
+		column->reserve(count);
+	}
+}
+
+void SpriteCatalog::clear()
+{
+	m_names.clear();
+	m_nameOffsets.assign(1, 0);
+	for (auto* column : {&m_x, &m_y, &m_width, &m_height, &m_rotation, &m_page, &m_trimX, &m_trimY, &m_sourceWidth, &m_sourceHeight, &m_channel}) {
+		column->clear();
+	}
+}
+
+uint32_t SpriteCatalog::add(const std::string_view name,
+							const uint32_t x, const uint32_t y,
+							const uint32_t width, const uint32_t height,
+							const uint32_t rotation,
+							const uint32_t page)
+{
+	const uint32_t index = size();
+	assert(x <= UINT16_MAX && y <= UINT16_MAX && width <= UINT16_MAX && height <= UINT16_MAX && page <= UINT16_MAX);
+
+	m_names.append(name);
+	m_nameOffsets.push_back(static_cast<uint32_t>(m_names.size()));
+	m_x.push_back(static_cast<uint16_t>(x));
+	m_y.push_back(static_cast<uint16_t>(y));
+	m_width.push_back(static_cast<uint16_t>(width));
+	m_height.push_back(static_cast<uint16_t>(height));
+	m_rotation.push_back(static_cast<uint16_t>(rotation));
+	m_page.push_back(static_cast<uint16_t>(page));
+
+	// The whole source image is packed, rotated back to its original orientation
+	const bool rotated = rotation != 0;
+	m_trimX.push_back(0);
+	m_trimY.push_back(0);
+	m_sourceWidth.push_back(static_cast<uint16_t>(rotated ? height : width));
+	m_sourceHeight.push_back(static_cast<uint16_t>(rotated ? width : height));
+	m_channel.push_back(0);
+
+	return index;
+}
+
+void SpriteCatalog::setChannel(const uint32_t index, const uint32_t channel)
+{
+	m_channel[index] = static_cast<uint16_t>(channel);
+}
+
+bool SpriteCatalog::hasChannels() const
+{
+	return std::any_of(m_channel.begin(), m_channel.end(), [](const uint16_t channel) { return channel != 0; });
+}
+
+uint32_t SpriteCatalog::pageCount() const
+{
+	if (m_page.empty()) return 0;
+	return static_cast<uint32_t>(*std::max_element(m_page.begin(), m_page.end())) + 1;
+}
+
+const char* channelName(const uint32_t channel)
+{
+	constexpr const char* names[] = {"rgba", "r", "g", "b", "a"};
+	return channel < 5 ? names[channel] : "rgba";
+}
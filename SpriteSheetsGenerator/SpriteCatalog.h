@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+   Metadata of every sprite of a sheet, stored as one column per field so that the writers iterate over contiguous memory.
+   Names live in a single arena and are referenced by 32-bit offsets, the filename of the sheet is stored once.
+   Coordinates and page indices are 16 bits, which is enough for any texture size the GPUs support; --page-size is limited to
+   65535x65535 so that they never wrap.
+*/
+class SpriteCatalog {
+public:
+	void reserve(size_t count, size_t nameBytes = 0);
+	void clear();
+
+	/* Add a sprite that is not trimmed and return its index, every value must fit in 16 bits. */
+	uint32_t add(std::string_view name, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t rotation, uint32_t page);
+
+	/* Record that the sprite is a mask in one channel of its page: 1 to 4 for red, green, blue or alpha. */
+	void setChannel(uint32_t index, uint32_t channel);
+
+	void setFilename(const std::string& filename)
+	{
+		m_filename = filename;
+	}
+
+	// Filename of the first page of the sheet
+	const std::string& getFilename() const
+	{
+		return m_filename;
+	}
+
+	uint32_t size() const
+	{
+		return static_cast<uint32_t>(m_x.size());
+	}
+
+	bool empty() const
+	{
+		return m_x.empty();
+	}
+
+	std::string_view getName(const uint32_t index) const
+	{
+		return std::string_view(m_names).substr(m_nameOffsets[index], m_nameOffsets[index + 1] - m_nameOffsets[index]);
+	}
+
+	uint32_t getX(const uint32_t index) const { return m_x[index]; }
+	uint32_t getY(const uint32_t index) const { return m_y[index]; }
+	uint32_t getWidth(const uint32_t index) const { return m_width[index]; }
+	uint32_t getHeight(const uint32_t index) const { return m_height[index]; }
+	uint32_t getRotation(const uint32_t index) const { return m_rotation[index]; }
+	uint32_t getPage(const uint32_t index) const { return m_page[index]; }
+	uint32_t getTrimX(const uint32_t index) const { return m_trimX[index]; }
+	uint32_t getTrimY(const uint32_t index) const { return m_trimY[index]; }
+	uint32_t getSourceWidth(const uint32_t index) const { return m_sourceWidth[index]; }
+	uint32_t getSourceHeight(const uint32_t index) const { return m_sourceHeight[index]; }
+	uint32_t getChannel(const uint32_t index) const { return m_channel[index]; }
+
+	/* True if a sprite is a mask in one channel of its page. */
+	bool hasChannels() const;
+
+	/* Number of pages referenced by the sprites. */
+	uint32_t pageCount() const;
+
+private:
+	std::string           m_filename;
+	std::string           m_names;				// every name, one after the other
+	std::vector<uint32_t> m_nameOffsets{0};		// name i is [m_nameOffsets[i], m_nameOffsets[i + 1])
+	std::vector<uint16_t> m_x;
+	std::vector<uint16_t> m_y;
+	std::vector<uint16_t> m_width;				// size in the sheet, swapped when rotated
+	std::vector<uint16_t> m_height;
+	std::vector<uint16_t> m_rotation;			// 0 or 90 degrees
+	std::vector<uint16_t> m_page;
+	std::vector<uint16_t> m_trimX;				// offset of the packed pixels in the source image
+	std::vector<uint16_t> m_trimY;
+	std::vector<uint16_t> m_sourceWidth;		// size of the source image before trimming
+	std::vector<uint16_t> m_sourceHeight;
+	std::vector<uint16_t> m_channel;			// 0 for a sprite in whole pixels, 1 to 4 for a mask in the red to alpha channel
+};
+
+/* The name of a channel of SpriteCatalog: "rgba", "r", "g", "b" or "a". */
+const char* channelName(uint32_t channel);
@@ -0,0 +1,38 @@
+#include "TextureFormat.h"
+
+bool parseTextureFormat(const std::string_view text, TextureFormat& format)
+{
+	if (text == "rgba8") format = TextureFormat::Rgba8;
+	else if (text == "rgba4444") format = TextureFormat::Rgba4444;
+	else if (text == "rgb565") format = TextureFormat::Rgb565;
+	else if (text == "rgba5551") format = TextureFormat::Rgba5551;
+	else if (text == "bc1") format = TextureFormat::Bc1;
+	else if (text == "bc3") format = TextureFormat::Bc3;
+	else if (text == "etc2") format = TextureFormat::Etc2;
+	else return false;
+	return true;
+}
+
+bool isBlockCompressed(const TextureFormat format)
+{
+	return format == TextureFormat::Bc1 || format == TextureFormat::Bc3 || format == TextureFormat::Etc2;
+}
+
+uint32_t texelBlockBytes(const TextureFormat format)
+{
+	switch (format) {
+	case TextureFormat::Rgba4444:
+	case TextureFormat::Rgb565:
+	case TextureFormat::Rgba5551: return 2;
+	case TextureFormat::Bc1:      return 8;
+	case TextureFormat::Bc3:
+	case TextureFormat::Etc2:     return 16;
+	default:                      return 4;
+	}
+}
+
+size_t textureSize(const TextureFormat format, const uint32_t width, const uint32_t height)
+{
+	if (isBlockCompressed(format)) return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * texelBlockBytes(format);
+	return static_cast<size_t>(width) * height * texelBlockBytes(format);
+}
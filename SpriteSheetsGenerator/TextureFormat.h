@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Pixel format of the GPU textures of the pages
+enum class TextureFormat {
+	Rgba8,			// 4 bytes per pixel, as composited
+	Rgba4444,		// 2 bytes per pixel, A4R4G4B4
+	Rgb565,			// 2 bytes per pixel, R5G6B5 without alpha
+	Rgba5551,		// 2 bytes per pixel, A1R5G5B5
+	Bc1,			// 8 bytes per block of 4x4 pixels, RGB with 1-bit alpha (DXT1)
+	Bc3,			// 16 bytes per block of 4x4 pixels, RGB and interpolated alpha (DXT5)
+	Etc2			// 16 bytes per block of 4x4 pixels, ETC2 RGB and EAC alpha, only in KTX2
+};
+
+/* Parse "rgba8", "rgba4444", "rgb565", "rgba5551", "bc1", "bc3" or "etc2", return false for anything else. */
+bool parseTextureFormat(std::string_view text, TextureFormat& format);
+
+/* True for the formats that encode blocks of 4x4 pixels. */
+bool isBlockCompressed(TextureFormat format);
+
+/* Bytes of a pixel, or of a block of 4x4 pixels for the block compressed formats. */
+uint32_t texelBlockBytes(TextureFormat format);
+
+/* Bytes of a width x height image in the format, the last row and column of blocks are padded. */
+size_t textureSize(TextureFormat format, uint32_t width, uint32_t height);
@@ -0,0 +1,345 @@
+#include "TextureWriter.h"
+
+#include <algorithm>
+#include <zlib.h>
+#include "AtomicFile.h"
+#include "PackedPixels.h"
+
+namespace {
+
+// Flags of the DDS header, see DDS_HEADER in the Direct3D documentation
+constexpr uint32_t DDSD_CAPS        = 0x1;
+constexpr uint32_t DDSD_HEIGHT      = 0x2;
+constexpr uint32_t DDSD_WIDTH       = 0x4;
+constexpr uint32_t DDSD_PITCH       = 0x8;
+constexpr uint32_t DDSD_PIXELFORMAT = 0x1000;
+constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+constexpr uint32_t DDSD_LINEARSIZE  = 0x80000;
+constexpr uint32_t DDPF_ALPHAPIXELS = 0x1;
+constexpr uint32_t DDPF_FOURCC      = 0x4;
+constexpr uint32_t DDPF_RGB         = 0x40;
+constexpr uint32_t DDSCAPS_COMPLEX  = 0x8;
+constexpr uint32_t DDSCAPS_TEXTURE  = 0x1000;
+constexpr uint32_t DDSCAPS_MIPMAP   = 0x400000;
+
+// Values of the KTX2 header and of its data format descriptor, see the KTX 2.0 and Khronos Data Format specifications
+constexpr uint8_t  KTX2_IDENTIFIER[12]       = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+constexpr uint32_t KTX2_HEADER_BYTES         = 80;			// identifier, header and index
+constexpr uint32_t KTX2_LEVEL_BYTES          = 24;			// byteOffset, byteLength and uncompressedByteLength of a level
+constexpr uint32_t KTX2_SUPERCOMPRESS_ZLIB   = 3;
+constexpr uint32_t VK_FORMAT_R5G6B5_UNORM    = 4;
+constexpr uint32_t VK_FORMAT_A1R5G5B5_UNORM  = 8;
+constexpr uint32_t VK_FORMAT_R8G8B8A8_SRGB   = 43;
+constexpr uint32_t VK_FORMAT_A4R4G4B4_UNORM  = 1000340000;
+constexpr uint32_t VK_FORMAT_BC1_RGBA_SRGB   = 134;
+constexpr uint32_t VK_FORMAT_BC3_SRGB        = 138;
+constexpr uint32_t VK_FORMAT_ETC2_RGBA8_SRGB = 152;		// VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK
+constexpr uint8_t  KHR_DF_MODEL_RGBSDA       = 1;
+constexpr uint8_t  KHR_DF_MODEL_BC1A         = 128;
+constexpr uint8_t  KHR_DF_MODEL_BC3          = 130;
+constexpr uint8_t  KHR_DF_MODEL_ETC2         = 161;
+constexpr uint8_t  KHR_DF_PRIMARIES_BT709    = 1;
+constexpr uint8_t  KHR_DF_TRANSFER_LINEAR    = 1;
+constexpr uint8_t  KHR_DF_TRANSFER_SRGB      = 2;
+constexpr uint8_t  KHR_DF_FLAG_PREMULTIPLIED = 1;
+constexpr uint8_t  KHR_DF_CHANNEL_ALPHA      = 15;
+constexpr uint8_t  KHR_DF_CHANNEL_ETC2_COLOR = 2;
+constexpr uint8_t  KHR_DF_SAMPLE_LINEAR      = 0x10;		// the alpha of an sRGB texture is linear
+constexpr char     KTX2_WRITER[]             = "KTXwriter\0SpriteSheetsGenerator";
+
+void putU32(uint8_t* out, const size_t offset, const uint32_t value)
+{
+	for (int i = 0; i < 4; i++) out[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+void putU64(uint8_t* out, const size_t offset, const uint64_t value)
+{
+	for (int i = 0; i < 8; i++) out[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+uint32_t fourCC(const char (&code)[5])
+{
+	return static_cast<uint32_t>(code[0]) | static_cast<uint32_t>(code[1]) << 8 | static_cast<uint32_t>(code[2]) << 16 | static_cast<uint32_t>(code[3]) << 24;
+}
+
+size_t alignUp(const size_t value, const size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// A sample of the data format descriptor: a channel and its bits in the texel block
+struct DfdSample {
+	uint32_t bitOffset;
+	uint32_t bitLength;
+	uint8_t  channel;
+	uint32_t upper;
+};
+
+uint32_t vulkanFormat(const TextureFormat format)
+{
+	switch (format) {
+	case TextureFormat::Rgba4444: return VK_FORMAT_A4R4G4B4_UNORM;
+	case TextureFormat::Rgb565:   return VK_FORMAT_R5G6B5_UNORM;
+	case TextureFormat::Rgba5551: return VK_FORMAT_A1R5G5B5_UNORM;
+	case TextureFormat::Bc1:      return VK_FORMAT_BC1_RGBA_SRGB;
+	case TextureFormat::Bc3:      return VK_FORMAT_BC3_SRGB;
+	case TextureFormat::Etc2:     return VK_FORMAT_ETC2_RGBA8_SRGB;
+	default:                      return VK_FORMAT_R8G8B8A8_SRGB;
+	}
+}
+
+/* The data format descriptor of the pixels, with its total size first. */
+std::vector<uint8_t> dataFormatDescriptor(const TextureFormat format, const bool premultiplied, const bool supercompressed)
+{
+	std::vector<DfdSample> samples;
+	uint8_t                model     = KHR_DF_MODEL_RGBSDA;
+	uint8_t                transfer  = KHR_DF_TRANSFER_SRGB;
+	uint8_t                blockSize = isBlockCompressed(format) ? 3 : 0;		// texel block dimension minus one
+
+	switch (format) {
+	case TextureFormat::Bc1:
+		model   = KHR_DF_MODEL_BC1A;
+		samples = {{0, 64, 1, 0xFFFFFFFF}};		// channel 1 is "alpha present"
+		break;
+	case TextureFormat::Bc3:
+		model   = KHR_DF_MODEL_BC3;
+		samples = {{0, 64, KHR_DF_CHANNEL_ALPHA | KHR_DF_SAMPLE_LINEAR, 0xFFFFFFFF}, {64, 64, 0, 0xFFFFFFFF}};
+		break;
+	case TextureFormat::Etc2:
+		model   = KHR_DF_MODEL_ETC2;
+		samples = {{0, 64, KHR_DF_CHANNEL_ALPHA | KHR_DF_SAMPLE_LINEAR, 0xFFFFFFFF}, {64, 64, KHR_DF_CHANNEL_ETC2_COLOR, 0xFFFFFFFF}};
+		break;
+	case TextureFormat::Rgba8:
+		samples = {{0, 8, 0, 255}, {8, 8, 1, 255}, {16, 8, 2, 255}, {24, 8, KHR_DF_CHANNEL_ALPHA | KHR_DF_SAMPLE_LINEAR, 255}};
+		break;
+	default: {
+		// The 16-bit formats only exist as UNORM, the values are read without conversion
+		const PackedLayout layout = packedLayout(format);
+		transfer = KHR_DF_TRANSFER_LINEAR;
+		for (int c = 0; c < 4; c++) {
+			if (layout.bits[c] == 0) continue;
+			const uint8_t channel = c == 3 ? KHR_DF_CHANNEL_ALPHA : static_cast<uint8_t>(c);
+			samples.push_back({static_cast<uint32_t>(layout.shift[c]), static_cast<uint32_t>(layout.bits[c]), channel, (1u << layout.bits[c]) - 1});
+		}
+		break;
+	}
+	}
+
+	const auto           blockBytes = static_cast<uint32_t>(24 + 16 * samples.size());
+	std::vector<uint8_t> dfd(4 + blockBytes, 0);
+	putU32(dfd.data(), 0, static_cast<uint32_t>(dfd.size()));
+	putU32(dfd.data(), 8, 2 | blockBytes << 16);
+	dfd[12] = model;
+	dfd[13] = KHR_DF_PRIMARIES_BT709;
+	dfd[14] = transfer;
+	dfd[15] = premultiplied ? KHR_DF_FLAG_PREMULTIPLIED : 0;
+	dfd[16] = blockSize;
+	dfd[17] = blockSize;
+	dfd[20] = supercompressed ? 0 : static_cast<uint8_t>(texelBlockBytes(format));		// unknown once the levels are deflated
+
+	for (size_t i = 0; i < samples.size(); i++) {
+		const size_t offset = 28 + 16 * i;
+		putU32(dfd.data(), offset, samples[i].bitOffset | (samples[i].bitLength - 1) << 16 | static_cast<uint32_t>(samples[i].channel) << 24);
+		putU32(dfd.data(), offset + 12, samples[i].upper);
+	}
+	return dfd;
+}
+
+}
+
+bool parseTextureContainer(const std::string_view text, TextureContainer& container)
+{
+	if (text == "none") container = TextureContainer::None;
+	else if (text == "dds") container = TextureContainer::Dds;
+	else if (text == "ktx2") container = TextureContainer::Ktx2;
+	else return false;
+	return true;
+}
+
+const char* textureContainerExtension(const TextureContainer container)
+{
+	switch (container) {
+		case TextureContainer::Dds: return ".dds";
+		case TextureContainer::Ktx2: return ".ktx2";
+		default: return "";
+	}
+}
+
+bool TextureWriter::open(const std::string& path, const TextureContainer container, const TextureFormat format, const uint32_t width, const uint32_t height,
+                         const uint32_t levels, const bool premultiplied, const bool supercompress)
+{
+	m_path          = path;
+	m_container     = container;
+	m_format        = format;
+	m_width         = width;
+	m_height        = height;
+	m_levels        = std::max(1u, levels);
+	m_written       = 0;
+	m_supercompress = supercompress && container == TextureContainer::Ktx2;
+	m_offsets.clear();
+	m_deflated.clear();
+
+	m_temporary = temporaryPath(path);
+	m_file.open(m_temporary, std::ios::binary | std::ios::trunc);
+	if (!m_file.is_open()) return false;
+
+	if (container == TextureContainer::Dds) writeDdsHeader();
+	else writeKtx2Header(premultiplied);
+	return !m_file.fail();
+}
+
+size_t TextureWriter::levelBytes(const uint32_t level) const
+{
+	return textureSize(m_format, std::max(1u, m_width >> level), std::max(1u, m_height >> level));
+}
+
+void TextureWriter::writeDdsHeader()
+{
+	// Magic followed by the 124 bytes of DDS_HEADER, its pixel format at offset 76
+	uint8_t header[128] = {};
+	putU32(header, 0, fourCC("DDS "));
+	putU32(header, 4, 124);
+	putU32(header, 12, m_height);
+	putU32(header, 16, m_width);
+	putU32(header, 28, m_levels);
+	putU32(header, 76, 32);
+	putU32(header, 108, DDSCAPS_TEXTURE | (m_levels > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0));
+
+	uint32_t flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | (m_levels > 1 ? DDSD_MIPMAPCOUNT : 0);
+	if (isBlockCompressed(m_format)) {
+		flags |= DDSD_LINEARSIZE;
+		putU32(header, 20, static_cast<uint32_t>(levelBytes(0)));
+		putU32(header, 80, DDPF_FOURCC);
+		putU32(header, 84, m_format == TextureFormat::Bc1 ? fourCC("DXT1") : fourCC("DXT5"));
+	}
+	else if (m_format == TextureFormat::Rgba8) {
+		flags |= DDSD_PITCH;
+		putU32(header, 20, m_width * 4);
+		putU32(header, 80, DDPF_RGB | DDPF_ALPHAPIXELS);
+		putU32(header, 88, 32);
+		putU32(header, 92, 0x000000FF);
+		putU32(header, 96, 0x0000FF00);
+		putU32(header, 100, 0x00FF0000);
+		putU32(header, 104, 0xFF000000);
+	}
+	else {
+		// Masks of the R, G, B and A channels in the 16-bit texels
+		const PackedLayout layout = packedLayout(m_format);
+		flags |= DDSD_PITCH;
+		putU32(header, 20, m_width * 2);
+		putU32(header, 80, DDPF_RGB | (layout.bits[3] > 0 ? DDPF_ALPHAPIXELS : 0));
+		putU32(header, 88, 16);
+		for (int c = 0; c < 4; c++) {
+			putU32(header, 92 + 4 * c, ((1u << layout.bits[c]) - 1) << layout.shift[c]);
+		}
+	}
+	putU32(header, 8, flags);
+
+	m_file.write(reinterpret_cast<const char*>(header), sizeof(header));
+}
+
+void TextureWriter::writeKtx2Header(const bool premultiplied)
+{
+	const std::vector<uint8_t> dfd = dataFormatDescriptor(m_format, premultiplied, m_supercompress);
+
+	m_indexOffset = KTX2_HEADER_BYTES;
+	const size_t dfdOffset = m_indexOffset + static_cast<size_t>(m_levels) * KTX2_LEVEL_BYTES;
+	const size_t kvdOffset = dfdOffset + dfd.size();
+	const size_t kvdBytes  = alignUp(4 + sizeof(KTX2_WRITER), 4);
+
+	std::vector<uint8_t> header(kvdOffset + kvdBytes, 0);
+	std::copy(std::begin(KTX2_IDENTIFIER), std::end(KTX2_IDENTIFIER), header.begin());
+	putU32(header.data(), 12, vulkanFormat(m_format));
+	putU32(header.data(), 16, isBlockCompressed(m_format) || m_format == TextureFormat::Rgba8 ? 1 : texelBlockBytes(m_format));	// typeSize, 2 for the *_PACK16 formats
+	putU32(header.data(), 20, m_width);
+	putU32(header.data(), 24, m_height);
+	putU32(header.data(), 32, 0);			// layerCount
+	putU32(header.data(), 36, 1);			// faceCount
+	putU32(header.data(), 40, m_levels);
+	putU32(header.data(), 44, m_supercompress ? KTX2_SUPERCOMPRESS_ZLIB : 0);
+	putU32(header.data(), 48, static_cast<uint32_t>(dfdOffset));
+	putU32(header.data(), 52, static_cast<uint32_t>(dfd.size()));
+	putU32(header.data(), 56, static_cast<uint32_t>(kvdOffset));
+	putU32(header.data(), 60, static_cast<uint32_t>(kvdBytes));
+	std::copy(dfd.begin(), dfd.end(), header.begin() + static_cast<long>(dfdOffset));
+	putU32(header.data(), kvdOffset, static_cast<uint32_t>(sizeof(KTX2_WRITER)));
+	std::copy(std::begin(KTX2_WRITER), std::end(KTX2_WRITER), header.begin() + static_cast<long>(kvdOffset + 4));
+
+	// The level index is filled when the file is closed
+	m_file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+
+	// Uncompressed levels are aligned on their texel blocks, from the smallest level to the largest
+	m_dataStart = header.size();
+	if (!m_supercompress) {
+		const size_t alignment = std::max<size_t>(4, texelBlockBytes(m_format));
+		size_t       offset    = m_dataStart;
+		m_offsets.resize(m_levels);
+		for (uint32_t level = m_levels; level-- > 0;) {
+			offset            = alignUp(offset, alignment);
+			m_offsets[level]  = offset;
+			offset           += levelBytes(level);
+		}
+	}
+}
+
+bool TextureWriter::writeLevel(const uint8_t* data, const size_t bytes)
+{
+	if (m_written >= m_levels || bytes != levelBytes(m_written)) return false;
+
+	if (m_container == TextureContainer::Dds) {
+		m_file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+	}
+	else if (m_supercompress) {
+		uLongf                deflatedBytes = compressBound(static_cast<uLong>(bytes));
+		std::vector<uint8_t>& deflated      = m_deflated.emplace_back(deflatedBytes);
+		if (compress2(deflated.data(), &deflatedBytes, data, static_cast<uLong>(bytes), Z_BEST_COMPRESSION) != Z_OK) return false;
+		deflated.resize(deflatedBytes);
+	}
+	else {
+		m_file.seekp(static_cast<std::streamoff>(m_offsets[m_written]));
+		m_file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+	}
+
+	m_written++;
+	return !m_file.fail();
+}
+
+bool TextureWriter::close()
+{
+	bool ok = m_written == m_levels;
+
+	if (ok && m_container == TextureContainer::Ktx2) {
+		// Deflated levels go after the header without alignment, the smallest first
+		if (m_supercompress) {
+			m_offsets.assign(m_levels, 0);
+			m_file.seekp(static_cast<std::streamoff>(m_dataStart));
+			size_t offset = m_dataStart;
+			for (uint32_t level = m_levels; level-- > 0;) {
+				m_offsets[level] = offset;
+				m_file.write(reinterpret_cast<const char*>(m_deflated[level].data()), static_cast<std::streamsize>(m_deflated[level].size()));
+				offset += m_deflated[level].size();
+			}
+		}
+
+		std::vector<uint8_t> index(static_cast<size_t>(m_levels) * KTX2_LEVEL_BYTES);
+		for (uint32_t level = 0; level < m_levels; level++) {
+			const size_t entry = static_cast<size_t>(level) * KTX2_LEVEL_BYTES;
+			putU64(index.data(), entry, m_offsets[level]);
+			putU64(index.data(), entry + 8, m_supercompress ? m_deflated[level].size() : levelBytes(level));
+			putU64(index.data(), entry + 16, levelBytes(level));
+		}
+		m_file.seekp(static_cast<std::streamoff>(m_indexOffset));
+		m_file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size()));
+	}
+
+	m_file.close();
+	ok = ok && !m_file.fail();
+	m_file.clear();
+	m_deflated.clear();
+
+	if (!ok) {
+		discardFile(m_temporary);
+		return false;
+	}
+	return commitFile(m_temporary, m_path);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "TextureFormat.h"
+
+// Files that hold a page in the layout the GPU uploads, with its mip chain
+enum class TextureContainer {
+	None,		// pages are only written as PNG
+	Dds,		// Direct3D, no supercompression
+	Ktx2		// Khronos, the levels can be deflated
+};
+
+/* Parse "none", "dds" or "ktx2", return false for anything else. */
+bool parseTextureContainer(std::string_view text, TextureContainer& container);
+
+/* The file extension of a container, with the dot. */
+const char* textureContainerExtension(TextureContainer container);
+
+/*
+   Streaming writer of DDS and KTX2 textures: the header is written when the file is opened and every level as soon as it is
+   produced, so a page never needs a second full copy in memory. KTX2 stores the smallest level first, the offsets of the
+   levels are computed up front and each level is written at its place; deflated levels are only known once compressed so
+   they are kept until the file is closed, which is cheap since they are the smaller copy.
+   Offsets are aligned on the texels of 'format' so the runtime can map the file and upload the levels as they are.
+*/
+class TextureWriter {
+public:
+	/* The file is written to a temporary path and only replaces 'path' when it is closed without error. */
+	bool open(const std::string& path, TextureContainer container, TextureFormat format, uint32_t width, uint32_t height, uint32_t levels,
+	          bool premultiplied, bool supercompress);
+
+	/* Write the next level, largest first: 'bytes' of pixels or blocks. */
+	bool writeLevel(const uint8_t* data, size_t bytes);
+
+	bool close();
+
+private:
+	void writeDdsHeader();
+	void writeKtx2Header(bool premultiplied);
+
+	/* Size in bytes of a level before supercompression. */
+	size_t levelBytes(uint32_t level) const;
+
+	std::ofstream                     m_file;
+	std::string                       m_path;
+	std::string                       m_temporary;		// written until close renames it over m_path
+	TextureContainer                  m_container     = TextureContainer::None;
+	TextureFormat                     m_format        = TextureFormat::Rgba8;
+	uint32_t                          m_width         = 0;
+	uint32_t                          m_height        = 0;
+	uint32_t                          m_levels        = 0;
+	uint32_t                          m_written       = 0;		// levels written so far
+	bool                              m_supercompress = false;
+	std::vector<uint64_t>             m_offsets;				// KTX2 offset of every level in the file
+	std::vector<std::vector<uint8_t>> m_deflated;				// KTX2 levels deflated, written when the file is closed
+	size_t                            m_dataStart     = 0;		// KTX2 offset of the first level
+	size_t                            m_indexOffset   = 0;		// KTX2 offset of the level index
+};
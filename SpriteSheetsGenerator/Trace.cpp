@@ -0,0 +1,128 @@
+#include "Trace.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "AtomicFile.h"
+
+namespace {
+
+struct TraceEvent {
+	const char* name;
+	std::string detail;
+	int64_t     index;
+	int64_t     start;			// nanoseconds since startTrace
+	int64_t     duration;
+};
+
+// Spans of one thread, only locked against writeTrace
+struct ThreadTrace {
+	uint32_t                id = 0;
+	std::mutex              mutex;
+	std::vector<TraceEvent> events;
+};
+
+std::mutex                                traceMutex;
+std::vector<std::shared_ptr<ThreadTrace>> traceThreads;		// kept after their thread exits
+std::chrono::steady_clock::time_point     traceOrigin;
+
+int64_t elapsed()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceOrigin).count();
+}
+
+ThreadTrace& currentThread()
+{
+	thread_local std::shared_ptr<ThreadTrace> trace;
+	if (!trace) {
+		trace = std::make_shared<ThreadTrace>();
+		std::lock_guard<std::mutex> lock(traceMutex);
+		trace->id = static_cast<uint32_t>(traceThreads.size() + 1);
+		traceThreads.push_back(trace);
+	}
+	return *trace;
+}
+
+void writeEscaped(std::ostream& out, const std::string_view text)
+{
+	for (const char c : text) {
+		if (c == '"' || c == '\\') out << '\\' << c;
+		else if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+		else out << c;
+	}
+}
+
+}
+
+void startTrace()
+{
+	currentThread();		// the thread that starts the trace is the first one, "main"
+
+	std::lock_guard<std::mutex> lock(traceMutex);
+	traceOrigin = std::chrono::steady_clock::now();
+	traceActive.store(true, std::memory_order_relaxed);
+}
+
+bool writeTrace(const std::string& path)
+{
+	const std::string temporary = temporaryPath(path);
+	std::ofstream     file(temporary, std::ios::trunc);
+	if (!file.is_open()) return false;
+
+	// Complete events, "X", with their times in microseconds, and the name of every thread
+	file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+
+	std::lock_guard<std::mutex> lock(traceMutex);
+	for (const auto& thread : traceThreads) {
+		std::lock_guard<std::mutex> threadLock(thread->mutex);
+
+		file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id
+		     << ",\"args\":{\"name\":\"" << (thread->id == 1 ? "main" : "worker") << "\"}}";
+		first = false;
+
+		for (const auto& event : thread->events) {
+			file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->id << ",\"ts\":" << event.start / 1000.0
+			     << ",\"dur\":" << event.duration / 1000.0;
+			if (!event.detail.empty() || event.index >= 0) {
+				file << ",\"args\":{";
+				if (!event.detail.empty()) {
+					file << "\"detail\":\"";
+					writeEscaped(file, event.detail);
+					file << '"';
+				}
+				if (event.index >= 0) file << (event.detail.empty() ? "" : ",") << "\"index\":" << event.index;
+				file << '}';
+			}
+			file << '}';
+		}
+	}
+	file << "\n]}\n";
+
+	file.close();
+	if (file.fail()) {
+		discardFile(temporary);
+		return false;
+	}
+	return commitFile(temporary, path);
+}
+
+void TraceScope::begin(const char* name, const std::string_view detail, const int64_t index)
+{
+	m_name   = name;
+	m_detail = detail;
+	m_index  = index;
+	m_start  = elapsed();
+}
+
+void TraceScope::end()
+{
+	const int64_t duration = elapsed() - m_start;
+	ThreadTrace&  thread   = currentThread();
+
+	std::lock_guard<std::mutex> lock(thread.mutex);
+	thread.events.push_back({m_name, std::move(m_detail), m_index, m_start, duration});
+}
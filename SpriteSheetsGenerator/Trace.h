@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/*
+   Spans of the stages of a build, recorded per thread and written as Chrome trace events, which chrome://tracing and Perfetto open.
+   Tracing is off until startTrace is called: a TraceScope then costs one relaxed load and does not allocate.
+*/
+
+// True while the spans are recorded
+inline std::atomic<bool> traceActive{false};
+
+/* Start recording the spans, the times of the trace start now. */
+void startTrace();
+
+/* Write every span recorded so far to 'path', the recording goes on. Return false if the file cannot be written. */
+bool writeTrace(const std::string& path);
+
+// Record the time between its construction and its destruction as one span of the current thread
+class TraceScope {
+public:
+	/* 'name' must outlive the trace, a string literal; 'detail' and 'index', when given, tell which file or page the span is about. */
+	explicit TraceScope(const char* name, const std::string_view detail = {}, const int64_t index = -1)
+	{
+		if (traceActive.load(std::memory_order_relaxed)) begin(name, detail, index);
+	}
+
+	TraceScope(const char* name, const int64_t index)
+		: TraceScope(name, {}, index) {}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+	~TraceScope()
+	{
+		if (m_start >= 0) end();
+	}
+
+private:
+	void begin(const char* name, std::string_view detail, int64_t index);
+	void end();
+
+	const char* m_name  = nullptr;
+	std::string m_detail;
+	int64_t     m_index = -1;
+	int64_t     m_start = -1;		// nanoseconds since startTrace, -1 when tracing is off
+};
@@ -19,13 +19,17 @@ namespace rbp {
 
 using namespace std;
 
-GuillotineBinPack::GuillotineBinPack()
+GuillotineBinPack::GuillotineBinPack(std::pmr::memory_resource *resource)
 :binWidth(0),
-binHeight(0)
+binHeight(0),
+usedRectangles(resource),
+freeRectangles(resource)
 {
 }
 
-GuillotineBinPack::GuillotineBinPack(int width, int height)
+GuillotineBinPack::GuillotineBinPack(int width, int height, std::pmr::memory_resource *resource)
+:usedRectangles(resource),
+freeRectangles(resource)
 {
 	Init(width, height);
 }
@@ -51,11 +55,14 @@ void GuillotineBinPack::Init(int width, int height)
 
 	freeRectangles.clear();
 	freeRectangles.push_back(n);
+	pack_stats(packStats.freeRectsHighWater = max<uint64_t>(packStats.freeRectsHighWater, 1));
 }
 
 void GuillotineBinPack::Insert(std::vector<RectSize> &rects, bool merge, 
 	FreeRectChoiceHeuristic rectChoice, GuillotineSplitHeuristic splitMethod)
 {
+	pack_stats(PackTimer timer(packStats.insertNanoseconds));
+
 	// Remember variables about the best packing choice we have made so far during the iteration process.
 	int bestFreeRect = 0;
 	int bestRect = 0;
@@ -67,11 +74,14 @@ void GuillotineBinPack::Insert(std::vector<RectSize> &rects, bool merge,
 	{
 		// Stores the penalty score of the best rectangle placement - bigger=worse, smaller=better.
 		int bestScore = std::numeric_limits<int>::max();
+		pack_stats(packStats.scores += rects.size());
 
 		for(size_t i = 0; i < freeRectangles.size(); ++i)
 		{
 			for(size_t j = 0; j < rects.size(); ++j)
 			{
+				pack_stats(packStats.scoredFreeRects++);
+
 				// If this rectangle is a perfect match, we pick it instantly.
 				if (rects[j].width == freeRectangles[i].width && rects[j].height == freeRectangles[i].height)
 				{
@@ -146,6 +156,7 @@ void GuillotineBinPack::Insert(std::vector<RectSize> &rects, bool merge,
 
 		// Remember the new used rectangle.
 		usedRectangles.push_back(newNode);
+		pack_stats(packStats.inserts++);
 
 		// Check that we're really producing correct packings here.
 		debug_assert(disjointRects.Add(newNode) == true);
@@ -339,6 +350,9 @@ void GuillotineBinPack::InsertMaxFitting(std::vector<RectSize> &rects, std::vect
 Rect GuillotineBinPack::Insert(int width, int height, bool merge, FreeRectChoiceHeuristic rectChoice, 
 	GuillotineSplitHeuristic splitMethod)
 {
+	pack_stats(PackTimer timer(packStats.insertNanoseconds));
+	pack_stats(packStats.scores++);
+
 	// Find where to put the new rectangle.
 	int freeNodeIndex = 0;
 	Rect newRect = FindPositionForNewNode(width, height, rectChoice, &freeNodeIndex);
@@ -357,6 +371,7 @@ Rect GuillotineBinPack::Insert(int width, int height, bool merge, FreeRectChoice
 
 	// Remember the new used rectangle.
 	usedRectangles.push_back(newRect);
+	pack_stats(packStats.inserts++);
 
 	// Check that we're really producing correct packings here.
 	debug_assert(disjointRects.Add(newRect) == true);
@@ -437,6 +452,8 @@ Rect GuillotineBinPack::FindPositionForNewNode(int width, int height, FreeRectCh
 	/// Try each free rectangle to find the best one for placement.
 	for(size_t i = 0; i < freeRectangles.size(); ++i)
 	{
+		pack_stats(packStats.scoredFreeRects++);
+
 		// If this is a perfect fit upright, choose it immediately.
 		if (width == freeRectangles[i].width && height == freeRectangles[i].height)
 		{
@@ -551,6 +568,8 @@ void GuillotineBinPack::SplitFreeRectByHeuristic(const Rect &freeRect, const Rec
 /// remove the original rectangle from the freeRectangles array after that.
 void GuillotineBinPack::SplitFreeRectAlongAxis(const Rect &freeRect, const Rect &placedRect, bool splitHorizontal)
 {
+	pack_stats(packStats.splitCalls++);
+
 	// Form the two new rectangles.
 	Rect bottom;
 	bottom.x = freeRect.x;
@@ -578,6 +597,9 @@ void GuillotineBinPack::SplitFreeRectAlongAxis(const Rect &freeRect, const Rect
 		freeRectangles.push_back(bottom);
 	if (right.width > 0 && right.height > 0)
 		freeRectangles.push_back(right);
+	pack_stats(packStats.splitRects += (bottom.width > 0 && bottom.height > 0) + (right.width > 0 && right.height > 0));
+	// The free rectangle split here is only erased by the caller, count it as still held.
+	pack_stats(packStats.freeRectsHighWater = max<uint64_t>(packStats.freeRectsHighWater, freeRectangles.size()));
 
 	debug_assert(disjointRects.Disjoint(bottom));
 	debug_assert(disjointRects.Disjoint(right));
@@ -593,9 +615,11 @@ void GuillotineBinPack::MergeFreeList()
 
 	// Do a Theta(n^2) loop to see if any pair of free rectangles could me merged into one.
 	// Note that we miss any opportunities to merge three rectangles into one. (should call this function again to detect that)
+	pack_stats(const size_t freeCount = freeRectangles.size());
 	for(size_t i = 0; i < freeRectangles.size(); ++i)
 		for(size_t j = i+1; j < freeRectangles.size(); ++j)
 		{
+			pack_stats(packStats.pruneTests++);
 			if (freeRectangles[i].width == freeRectangles[j].width && freeRectangles[i].x == freeRectangles[j].x)
 			{
 				if (freeRectangles[i].y == freeRectangles[j].y + freeRectangles[j].height)
@@ -629,6 +653,7 @@ void GuillotineBinPack::MergeFreeList()
 				}
 			}
 		}
+	pack_stats(packStats.pruneRemovals += freeCount - freeRectangles.size());
 
 #ifdef _DEBUG
 	test.Clear();
@@ -7,6 +7,7 @@
 */
 #pragma once
 
+#include <memory_resource>
 #include <vector>
 
 #include "Rect.h"
@@ -19,10 +20,11 @@ class GuillotineBinPack
 {
 public:
 	/// The initial bin size will be (0,0). Call Init to set the bin size.
-	GuillotineBinPack();
+	/// @param resource Allocates the rectangle lists, it must outlive the packer.
+	explicit GuillotineBinPack(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
 
 	/// Initializes a new bin of the given size.
-	GuillotineBinPack(int width, int height);
+	GuillotineBinPack(int width, int height, std::pmr::memory_resource *resource = std::pmr::get_default_resource());
 
 	/// (Re)initializes the packer to an empty bin of width x height units. Call whenever
 	/// you need to restart with a new bin.
@@ -78,26 +80,35 @@ public:
 
 	/// Returns the internal list of disjoint rectangles that track the free area of the bin. You may alter this vector
 	/// any way desired, as long as the end result still is a list of disjoint rectangles.
-	std::vector<Rect> &GetFreeRectangles() { return freeRectangles; }
+	std::pmr::vector<Rect> &GetFreeRectangles() { return freeRectangles; }
 
 	/// Returns the list of packed rectangles. You may alter this vector at will, for example, you can move a Rect from
 	/// this list to the Free Rectangles list to free up space on-the-fly, but notice that this causes fragmentation.
-	std::vector<Rect> &GetUsedRectangles() { return usedRectangles; }
+	std::pmr::vector<Rect> &GetUsedRectangles() { return usedRectangles; }
 
 	/// Performs a Rectangle Merge operation. This procedure looks for adjacent free rectangles and merges them if they
 	/// can be represented with a single rectangle. Takes up Theta(|freeRectangles|^2) time.
 	void MergeFreeList();
 
+#ifdef RBP_PACK_STATS
+	/// The work done since the packer was constructed, Init does not reset it.
+	const PackStats &Stats() const { return packStats; }
+#endif
+
 private:
 	int binWidth;
 	int binHeight;
 
 	/// Stores a list of all the rectangles that we have packed so far. This is used only to compute the Occupancy ratio,
 	/// so if you want to have the packer consume less memory, this can be removed.
-	std::vector<Rect> usedRectangles;
+	std::pmr::vector<Rect> usedRectangles;
 
 	/// Stores a list of rectangles that represents the free area of the bin. This rectangles in this list are disjoint.
-	std::vector<Rect> freeRectangles;
+	std::pmr::vector<Rect> freeRectangles;
+
+#ifdef RBP_PACK_STATS
+	PackStats packStats;
+#endif
 
 #ifdef _DEBUG
 	/// Used to track that the packer produces proper packings.
@@ -3,11 +3,28 @@
 
 	This work is released to Public Domain, do whatever you want with it.
 */
+#include <algorithm>
 #include <utility>
 
 #include "Rect.h"
 
 namespace rbp {
+#ifdef RBP_PACK_STATS
+	PackStats &PackStats::operator+=(const PackStats &other)
+	{
+		inserts += other.inserts;
+		insertNanoseconds += other.insertNanoseconds;
+		scores += other.scores;
+		scoredFreeRects += other.scoredFreeRects;
+		freeRectsHighWater = std::max(freeRectsHighWater, other.freeRectsHighWater);
+		splitCalls += other.splitCalls;
+		splitRects += other.splitRects;
+		pruneTests += other.pruneTests;
+		pruneRemovals += other.pruneRemovals;
+		return *this;
+	}
+#endif
+
 	/*
 	#include "clb/Algorithm/Sort.h"
 
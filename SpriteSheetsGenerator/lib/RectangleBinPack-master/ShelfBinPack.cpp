@@ -17,16 +17,20 @@ namespace rbp {
 
 using namespace std;
 
-ShelfBinPack::ShelfBinPack()
+ShelfBinPack::ShelfBinPack(std::pmr::memory_resource *resource)
 :binWidth(0),
 binHeight(0),
 currentY(0),
 usedSurfaceArea(0),
-useWasteMap(false)
+useWasteMap(false),
+wasteMap(resource),
+shelves(resource)
 {
 }
 
-ShelfBinPack::ShelfBinPack(int width, int height, bool useWasteMap)
+ShelfBinPack::ShelfBinPack(int width, int height, bool useWasteMap, std::pmr::memory_resource *resource)
+:wasteMap(resource),
+shelves(resource)
 {
 	Init(width, height, useWasteMap);
 }
@@ -65,17 +69,20 @@ void ShelfBinPack::StartNewShelf(int startingHeight)
 		assert(currentY < binHeight);
 	}
 
-	Shelf shelf;
+	// Moved into the list so that its rectangles stay on the resource of the packer
+	Shelf shelf(shelves.get_allocator().resource());
 	shelf.currentX = 0;
 	shelf.height = startingHeight;
 	shelf.startY = currentY;
 
 	assert(shelf.startY + shelf.height <= binHeight);
-	shelves.push_back(shelf);
+	shelves.push_back(std::move(shelf));
+	pack_stats(packStats.freeRectsHighWater = max<uint64_t>(packStats.freeRectsHighWater, shelves.size()));
 }
 
 bool ShelfBinPack::FitsOnShelf(const Shelf &shelf, int width, int height, bool canResize) const
 {
+	pack_stats(packStats.scoredFreeRects++);
 	const int shelfHeight = canResize ? (binHeight - shelf.startY) : shelf.height;
 	if ((shelf.currentX + width <= binWidth && height <= shelfHeight) ||
 		(shelf.currentX + height <= binWidth && width <= shelfHeight))
@@ -118,10 +125,13 @@ void ShelfBinPack::AddToShelf(Shelf &shelf, int width, int height, Rect &newNode
 	assert(shelf.height <= binHeight);
 
 	usedSurfaceArea += width * height;
+	pack_stats(packStats.inserts++);
 }
 
 Rect ShelfBinPack::Insert(int width, int height, ShelfChoiceHeuristic method)
 {
+	pack_stats(PackTimer timer(packStats.insertNanoseconds));
+
 	Rect newNode;
 
 	// First try to pack this rectangle into the waste map, if it fits.
@@ -133,11 +143,14 @@ Rect ShelfBinPack::Insert(int width, int height, ShelfChoiceHeuristic method)
 		{
 			// Track the space we just used.
 			usedSurfaceArea += width * height;
+			pack_stats(packStats.inserts++);
 
 			return newNode;
 		}
 	}
 
+	pack_stats(packStats.scores++);
+
 	switch(method)
 	{
 	case ShelfNextFit:		
@@ -356,7 +369,9 @@ Rect ShelfBinPack::Insert(int width, int height, ShelfChoiceHeuristic method)
 
 void ShelfBinPack::MoveShelfToWasteMap(Shelf &shelf)
 {
-	std::vector<Rect> &freeRects = wasteMap.GetFreeRectangles();
+	pack_stats(packStats.splitCalls++);
+	std::pmr::vector<Rect> &freeRects = wasteMap.GetFreeRectangles();
+	pack_stats(const size_t freeCount = freeRects.size());
 
 	// Add the gaps between each rect top and shelf ceiling to the waste map.
 	for(size_t i = 0; i < shelf.usedRectangles.size(); ++i)
@@ -383,6 +398,7 @@ void ShelfBinPack::MoveShelfToWasteMap(Shelf &shelf)
 
 	// This shelf is DONE.
 	shelf.currentX = binWidth;
+	pack_stats(packStats.splitRects += freeRects.size() - freeCount);
 
 	// Perform a rectangle merge step.
 	wasteMap.MergeFreeList();
@@ -394,4 +410,16 @@ float ShelfBinPack::Occupancy() const
 	return (float)usedSurfaceArea / (binWidth * binHeight);
 }
 
+#ifdef RBP_PACK_STATS
+PackStats ShelfBinPack::Stats() const
+{
+	// Insert already timed and counted the placements it made through the waste map.
+	PackStats stats = wasteMap.Stats();
+	stats.inserts = 0;
+	stats.insertNanoseconds = 0;
+	stats += packStats;
+	return stats;
+}
+#endif
+
 }
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include "GuillotineBinPack.h"
 #include "Rect.h"
 
+#include <memory_resource>
 #include <vector>
 
 namespace rbp {
@@ -20,9 +21,10 @@ class ShelfBinPack
 {
 public:
 	/// Default ctor initializes a bin of size (0,0). Call Init() to init an instance.
-	ShelfBinPack();
+	/// @param resource Allocates the shelves and the waste map, it must outlive the packer.
+	explicit ShelfBinPack(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
 
-	ShelfBinPack(int width, int height, bool useWasteMap);
+	ShelfBinPack(int width, int height, bool useWasteMap, std::pmr::memory_resource *resource = std::pmr::get_default_resource());
 
 	/// Clears all previously packed rectangles and starts packing from scratch into a bin of the given size.
 	void Init(int width, int height, bool useWasteMap);
@@ -47,6 +49,11 @@ public:
 	/// Computes the ratio of used surface area to the total bin area.
 	float Occupancy() const;
 
+#ifdef RBP_PACK_STATS
+	/// The work done since the packer was constructed, the waste map included. Init does not reset it.
+	PackStats Stats() const;
+#endif
+
 private:
 	int binWidth;
 	int binHeight;
@@ -61,9 +68,17 @@ private:
 	bool useWasteMap;
 	GuillotineBinPack wasteMap;
 
+#ifdef RBP_PACK_STATS
+	/// Mutable because the shelves are tried by const member functions.
+	mutable PackStats packStats;
+#endif
+
 	/// Describes a horizontal slab of space where rectangles may be placed.
 	struct Shelf
 	{
+		explicit Shelf(std::pmr::memory_resource *resource)
+		:currentX(0), startY(0), height(0), usedRectangles(resource) {}
+
 		/// The x-coordinate that specifies where the used shelf space ends.
 		/// Space between [0, currentX[ has been filled with rectangles, [currentX, binWidth[ is still available for filling.
 		int currentX;
@@ -75,10 +90,10 @@ private:
 		int height;
 
 		/// Lists all the rectangles in this shelf.
-		std::vector<Rect> usedRectangles;
+		std::pmr::vector<Rect> usedRectangles;
 	};
 
-	std::vector<Shelf> shelves;
+	std::pmr::vector<Shelf> shelves;
 
 	/// Parses through all rectangles added to the given shelf and adds the gaps between the rectangle tops and the shelf
 	/// ceiling into the waste map. This is called only once when the shelf is being closed and a new one is opened.
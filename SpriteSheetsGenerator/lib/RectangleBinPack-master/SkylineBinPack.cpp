@@ -19,13 +19,17 @@ namespace rbp {
 
 using namespace std;
 
-SkylineBinPack::SkylineBinPack()
+SkylineBinPack::SkylineBinPack(std::pmr::memory_resource *resource)
 :binWidth(0),
-binHeight(0)
+binHeight(0),
+skyLine(resource),
+wasteMap(resource)
 {
 }
 
-SkylineBinPack::SkylineBinPack(int width, int height, bool useWasteMap)
+SkylineBinPack::SkylineBinPack(int width, int height, bool useWasteMap, std::pmr::memory_resource *resource)
+:skyLine(resource),
+wasteMap(resource)
 {
 	Init(width, height, useWasteMap);
 }
@@ -48,6 +52,7 @@ void SkylineBinPack::Init(int width, int height, bool useWasteMap_)
 	node.y = 0;
 	node.width = binWidth;
 	skyLine.push_back(node);
+	pack_stats(packStats.freeRectsHighWater = max<uint64_t>(packStats.freeRectsHighWater, 1));
 
 	if (useWasteMap)
 	{
@@ -58,10 +63,14 @@ void SkylineBinPack::Init(int width, int height, bool useWasteMap_)
 
 void SkylineBinPack::Insert(std::vector<RectSize> &rects, std::vector<Rect> &dst, LevelChoiceHeuristic method)
 {
+	pack_stats(PackTimer timer(packStats.insertNanoseconds));
+
 	dst.clear();
 
 	while(rects.size() > 0)
 	{
+		pack_stats(packStats.scores += rects.size());
+
 		Rect bestNode;
 		int bestScore1 = std::numeric_limits<int>::max();
 		int bestScore2 = std::numeric_limits<int>::max();
@@ -110,11 +119,14 @@ void SkylineBinPack::Insert(std::vector<RectSize> &rects, std::vector<Rect> &dst
 		usedSurfaceArea += rects[bestRectIndex].width * rects[bestRectIndex].height;
 		rects.erase(rects.begin() + bestRectIndex);
 		dst.push_back(bestNode);
+		pack_stats(packStats.inserts++);
 	}
 }
 
 Rect SkylineBinPack::Insert(int width, int height, LevelChoiceHeuristic method)
 {
+	pack_stats(PackTimer timer(packStats.insertNanoseconds));
+
 	// First try to pack this rectangle into the waste map, if it fits.
 	Rect node = wasteMap.Insert(width, height, true, GuillotineBinPack::RectBestShortSideFit, 
 		GuillotineBinPack::SplitMaximizeArea);
@@ -132,8 +144,11 @@ Rect SkylineBinPack::Insert(int width, int height, LevelChoiceHeuristic method)
 		assert(disjointRects.Disjoint(newNode));
 		disjointRects.Add(newNode);
 #endif
+		pack_stats(packStats.inserts++);
 		return newNode;
 	}
+
+	pack_stats(packStats.scores++);
 	
 	switch(method)
 	{
@@ -212,11 +227,14 @@ void SkylineBinPack::AddWasteMapArea(int skylineNodeIndex, int width, int height
 
 		debug_assert(disjointRects.Disjoint(waste));
 		wasteMap.GetFreeRectangles().push_back(waste);
+		pack_stats(packStats.splitRects++);
 	}
 }
 
 void SkylineBinPack::AddSkylineLevel(int skylineNodeIndex, const Rect &rect)
 {
+	pack_stats(packStats.splitCalls++);
+
 	// First track all wasted areas and mark them into the waste map if we're using one.
 	if (useWasteMap)
 		AddWasteMapArea(skylineNodeIndex, rect.width, rect.height, rect.y);
@@ -226,6 +244,8 @@ void SkylineBinPack::AddSkylineLevel(int skylineNodeIndex, const Rect &rect)
 	newNode.y = rect.y + rect.height;
 	newNode.width = rect.width;
 	skyLine.insert(skyLine.begin() + skylineNodeIndex, newNode);
+	pack_stats(packStats.splitRects++);
+	pack_stats(packStats.freeRectsHighWater = max<uint64_t>(packStats.freeRectsHighWater, skyLine.size()));
 
 	assert(newNode.x + newNode.width <= binWidth);
 	assert(newNode.y <= binHeight);
@@ -258,12 +278,16 @@ void SkylineBinPack::AddSkylineLevel(int skylineNodeIndex, const Rect &rect)
 void SkylineBinPack::MergeSkylines()
 {
 	for(size_t i = 0; i < skyLine.size()-1; ++i)
+	{
+		pack_stats(packStats.pruneTests++);
 		if (skyLine[i].y == skyLine[i+1].y)
 		{
 			skyLine[i].width += skyLine[i+1].width;
 			skyLine.erase(skyLine.begin() + (i+1));
+			pack_stats(packStats.pruneRemovals++);
 			--i;
 		}
+	}
 }
 
 Rect SkylineBinPack::InsertBottomLeft(int width, int height)
@@ -281,6 +305,7 @@ Rect SkylineBinPack::InsertBottomLeft(int width, int height)
 		AddSkylineLevel(bestIndex, newNode);
 
 		usedSurfaceArea += width * height;
+		pack_stats(packStats.inserts++);
 #ifdef _DEBUG
 		disjointRects.Add(newNode);
 #endif
@@ -301,6 +326,7 @@ Rect SkylineBinPack::FindPositionForNewNodeBottomLeft(int width, int height, int
 	memset(&newNode, 0, sizeof(newNode));
 	for(size_t i = 0; i < skyLine.size(); ++i)
 	{
+		pack_stats(packStats.scoredFreeRects++);
 		int y;
 		if (RectangleFits(i, width, height, y))
 		{
@@ -350,6 +376,7 @@ Rect SkylineBinPack::InsertMinWaste(int width, int height)
 		AddSkylineLevel(bestIndex, newNode);
 
 		usedSurfaceArea += width * height;
+		pack_stats(packStats.inserts++);
 #ifdef _DEBUG
 		disjointRects.Add(newNode);
 #endif
@@ -369,6 +396,7 @@ Rect SkylineBinPack::FindPositionForNewNodeMinWaste(int width, int height, int &
 	memset(&newNode, 0, sizeof(newNode));
 	for(size_t i = 0; i < skyLine.size(); ++i)
 	{
+		pack_stats(packStats.scoredFreeRects++);
 		int y;
 		int wastedArea;
 
@@ -411,4 +439,16 @@ float SkylineBinPack::Occupancy() const
 	return (float)usedSurfaceArea / (binWidth * binHeight);
 }
 
+#ifdef RBP_PACK_STATS
+PackStats SkylineBinPack::Stats() const
+{
+	// Insert already timed and counted the placements it made through the waste map.
+	PackStats stats = wasteMap.Stats();
+	stats.inserts = 0;
+	stats.insertNanoseconds = 0;
+	stats += packStats;
+	return stats;
+}
+#endif
+
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 */
 #pragma once
 
+#include <memory_resource>
 #include <vector>
 
 #include "Rect.h"
@@ -20,10 +21,11 @@ class SkylineBinPack
 {
 public:
 	/// Instantiates a bin of size (0,0). Call Init to create a new bin.
-	SkylineBinPack();
+	/// @param resource Allocates the skyline and the waste map, it must outlive the packer.
+	explicit SkylineBinPack(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
 
 	/// Instantiates a bin of the given size.
-	SkylineBinPack(int binWidth, int binHeight, bool useWasteMap);
+	SkylineBinPack(int binWidth, int binHeight, bool useWasteMap, std::pmr::memory_resource *resource = std::pmr::get_default_resource());
 
 	/// (Re)initializes the packer to an empty bin of width x height units. Call whenever
 	/// you need to restart with a new bin.
@@ -48,6 +50,11 @@ public:
 	/// Computes the ratio of used surface area to the total bin area.
 	float Occupancy() const;
 
+#ifdef RBP_PACK_STATS
+	/// The work done since the packer was constructed, the waste map included. Init does not reset it.
+	PackStats Stats() const;
+#endif
+
 private:
 	int binWidth;
 	int binHeight;
@@ -69,7 +76,7 @@ private:
 		int width;
 	};
 
-	std::vector<SkylineNode> skyLine;
+	std::pmr::vector<SkylineNode> skyLine;
 
 	unsigned long usedSurfaceArea;
 
@@ -77,6 +84,11 @@ private:
 	bool useWasteMap;
 	GuillotineBinPack wasteMap;
 
+#ifdef RBP_PACK_STATS
+	/// Mutable because the placements are scored by const member functions.
+	mutable PackStats packStats;
+#endif
+
 	Rect InsertBottomLeft(int width, int height);
 	Rect InsertMinWaste(int width, int height);
 
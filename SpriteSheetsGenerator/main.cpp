@@ -13,7 +13,6 @@
 		1. rapidXML			http://sourceforge.net/projects/rapidxml/files/
 		2. SFML/SDL2
 		3. RectangleBinPack https://github.com/juj/RectangleBinPack
-		4. dirent.h
 
 	We will use the library of Jukka Jylnki released under public domain : 'RectangleBinPack'
 	Texture packing problem also known as Bin packing problem is NP-Hard.
@@ -29,185 +28,200 @@
 
 	NOTE* If everything is implemented, you may need to include '<algorithm>' in the MaxRectsBinPack.cpp to have 'min' and 'max'
 */
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
-#include <rapidxml.hpp>
-#include <rapidxml_ext.hpp>
+#include <sstream>
 #include <SFML/Graphics.hpp>
-#include "Image.h"
-#include "MaxRectsBinPack.h"
-#include "dirent.h"
-
-const char* toStr(const size_t value)
-{
-	const std::string str = std::to_string(value);
-	return str.c_str();
-}
-
-/*
-   Return the filename of every files in a folder, this method only works on Windows.
-   If you want to use this function you need to change the path of the filename and include the file "dirent.h"
-*/
-std::vector<std::string> getListFiles(const std::string& filepath)
+#include "AtomicFile.h"
+#include "Benchmark.h"
+#include "BuildServer.h"
+#include "DirectoryWatcher.h"
+#include "FileScanner.h"
+#include "Options.h"
+#include "Packer.h"
+#include "PixelPool.h"
+#include "SheetBuilder.h"
+#include "Trace.h"
+
+/* FNV-1a hash of the relative path and the content of every file under 'folder', in the order of the paths. */
+uint64_t hashFiles(const std::filesystem::path& folder)
 {
-	std::vector<std::string> list;
-	if (DIR* dir; (dir = opendir(filepath.c_str())) != nullptr) {
-		struct dirent* ent;
-		// Print all the files and directories within directory
-		while ((ent = readdir(dir)) != nullptr) {
-
-			if (std::string str = ent->d_name; str != "." && str != "..") list.push_back(str);
-		}
-		closedir(dir);
+	std::vector<std::filesystem::path> paths;
+	for (const auto& entry : std::filesystem::recursive_directory_iterator(folder)) {
+		if (entry.is_regular_file()) paths.push_back(entry.path());
 	}
-	return list;
-}
+	std::sort(paths.begin(), paths.end());
 
-/* The next function chooseBestHeuristic try every heuristics for the algorithm and pick the best one by comparing occupancy. */
-rbp::MaxRectsBinPack::FreeRectChoiceHeuristic chooseBestHeuristic(const std::vector<sf::Texture*>* rects, const size_t texWidth, const size_t texHeight)
-{
-	rbp::MaxRectsBinPack                                       pack;
-	std::vector<rbp::MaxRectsBinPack::FreeRectChoiceHeuristic> listHeuristics;
-	listHeuristics.push_back(rbp::MaxRectsBinPack::RectBestAreaFit);
-	listHeuristics.push_back(rbp::MaxRectsBinPack::RectBestLongSideFit);
-	listHeuristics.push_back(rbp::MaxRectsBinPack::RectBestShortSideFit);
-	listHeuristics.push_back(rbp::MaxRectsBinPack::RectBottomLeftRule);
-	listHeuristics.push_back(rbp::MaxRectsBinPack::RectContactPointRule);
-
-	rbp::MaxRectsBinPack::FreeRectChoiceHeuristic heuristicRule{};
-	float                                         max = 0;
-
-	for (const auto& heuristic : listHeuristics) {
-		pack.init(static_cast<int>(texWidth), static_cast<int>(texHeight));
-
-		for (const auto texture : *rects) {
-			pack.insert(static_cast<int>(texture->getSize().x), static_cast<int>(texture->getSize().y), heuristic);
+	uint64_t hash = 0xcbf29ce484222325ull;
+	auto     mix  = [&hash](const char* bytes, const size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			hash ^= static_cast<uint8_t>(bytes[i]);
+			hash *= 0x100000001b3ull;
 		}
+	};
 
-		if (pack.occupancy() > max) {
-			max           = pack.occupancy();
-			heuristicRule = heuristic;
-		}
+	for (const auto& path : paths) {
+		const std::string name = path.lexically_relative(folder).generic_string();
+		mix(name.c_str(), name.size() + 1);
+
+		std::ifstream file(path, std::ios::binary);
+		char          buffer[1 << 16];
+		while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) mix(buffer, static_cast<size_t>(file.gcount()));
 	}
-	return heuristicRule;
+	return hash;
 }
 
-/* The next functions getXMLSheet generate the xml document from the data. */
-std::string getXmlSheet(std::vector<Image> images, const std::string& name)
+/*
+   Build the sheet with 1, 4 and 32 threads, each one in its own temporary folder, and compare the layouts and every file written:
+   the threads must not change a single byte of the output. Return the exit code.
+*/
+int verifyDeterminism(const ImageCache& images, const ImageFiles& files, const bool direct, const std::vector<rbp::RectSize>& imgSizes,
+                      const Options& options, PixelPool& pool)
 {
-	rapidxml::xml_document<> doc;
-
-	rapidxml::xml_node<>* root = doc.allocate_node(rapidxml::node_element, "TextureList");
-	root->append_attribute(doc.allocate_attribute("Filename", doc.allocate_string(name.c_str())));
-	doc.append_node(root);
-
-	for (auto& img : images) {
-		rapidxml::xml_node<>* child = doc.allocate_node(rapidxml::node_element, "image");
-		child->append_attribute(doc.allocate_attribute("name", doc.allocate_string(img.getName().c_str())));
-		child->append_attribute(doc.allocate_attribute("x", doc.allocate_string(toStr(img.getX()))));
-		child->append_attribute(doc.allocate_attribute("y", doc.allocate_string(toStr(img.getY()))));
-		child->append_attribute(doc.allocate_attribute("w", doc.allocate_string(toStr(img.getWidth()))));
-		child->append_attribute(doc.allocate_attribute("h", doc.allocate_string(toStr(img.getHeight()))));
-
-		if (img.getRotation() != 0) {
-			child->append_attribute(doc.allocate_attribute("rotation", doc.allocate_string(toStr(img.getRotation()))));
+	namespace fs = std::filesystem;
+
+	if (options.optimizeMs > 0) std::cout << "Warning: --optimize-ms is not reproducible, use --optimize-iterations\n";
+
+	std::error_code error;
+	const fs::path  root = temporaryPath((fs::temp_directory_path(error) / "verify-determinism").string());
+
+	const std::vector<char> imgMasks = getMaskImages(images, options);
+	std::vector<uint64_t>   layoutHashes, fileHashes;
+	bool                    built = true;
+
+	for (const unsigned int threads : {1u, 4u, 32u}) {
+		Options build = options;
+		build.threads = threads;
+		build.output  = (root / ("threads" + std::to_string(threads))).string();
+		if (!build.header.empty()) build.header = (fs::path(build.output) / fs::path(options.header).filename()).string();
+		fs::create_directories(build.output, error);
+
+		std::ostringstream log;
+		const Layout       layout = computeLayout(imgSizes, imgMasks, build, threads);
+		if (!(direct ? buildSheet(files, layout, build, pool, log, nullptr) : buildSheet(images, layout, build, pool, log, nullptr))) {
+			std::cout << log.str();
+			built = false;
+			break;
 		}
 
-		root->append_node(child);
+		layoutHashes.push_back(hashLayout(layout));
+		fileHashes.push_back(hashFiles(build.output));
+		std::cout << "threads " << std::setw(2) << threads << " : layout " << std::hex << std::setfill('0') << std::setw(16) << layoutHashes.back()
+		          << ", files " << std::setw(16) << fileHashes.back() << std::dec << std::setfill(' ') << "\n";
 	}
+	fs::remove_all(root, error);
+	if (!built) return 1;
 
-	std::string xmlAsString;
-	print(std::back_inserter(xmlAsString), doc, 0);
-
-	return xmlAsString;
+	if (std::adjacent_find(layoutHashes.begin(), layoutHashes.end(), std::not_equal_to<>()) != layoutHashes.end()) {
+		std::cout << "Error: the layout depends on the number of threads\n";
+		return 1;
+	}
+	if (std::adjacent_find(fileHashes.begin(), fileHashes.end(), std::not_equal_to<>()) != fileHashes.end()) {
+		std::cout << "Error: the files written depend on the number of threads\n";
+		return 1;
+	}
+	return 0;
 }
 
-int main()
+/*
+   Build the sheet, then build it again every time the input folder changes until the program is killed.
+   Only the images that were touched are decoded again, the others stay in the cache.
+*/
+int watchImages(ImageCache& images, const Options& options, PixelPool& pool)
 {
-	std::vector<sf::Texture*> imgTex;					// images textures
-	std::vector<std::string>  imgTexID;					// name of the images
-	std::vector<Image>        images;					// xml data of the images
-	std::string               filename = "sheet";		// filename of the sprite sheet
-	sf::Vector2i              size(512, 512);		// size of the sprite sheet
-
-	sf::RenderTexture rend;								// texture to render the sprite sheet
-	rend.create(size.x, size.y);
-
-	rbp::MaxRectsBinPack pack(size.x, size.y); //pack of image
-
-	const std::string filepath = R"(C:\Users\LedLo\Downloads\_Glusoft\SpriteSheetsGenerator\SpriteSheetsGenerator\images\)";
-	// List all filename's in the folder images
-
-	// Load all the images
-	for (std::vector<std::string> listAll = getListFiles(filepath); auto& img : listAll) {
-		auto* texture = new sf::Texture();
-		texture->loadFromFile("images/" + img);
-		imgTex.push_back(texture);
-		imgTexID.push_back(img.substr(0, listAll.size() - 4));
-	}
-
-	float rotation = 0;
+	// Editors and exporters often write a file several times in a row, wait for them to be done
+	constexpr unsigned int QUIET_MS = 200;
 
-	// Choose the best heuristic
-	const rbp::MaxRectsBinPack::FreeRectChoiceHeuristic best1 = chooseBestHeuristic(&imgTex, size.x, size.y);
-
-	for (size_t i = 0; i < imgTex.size(); i++) {
-		// Insert the image into the pack
-		rbp::Rect packedRect = pack.insert(static_cast<int>(imgTex[i]->getSize().x), static_cast<int>(imgTex[i]->getSize().y), best1);
+	DirectoryWatcher watcher;
+	if (!watcher.open(options.input)) {
+		std::cout << "Error: cannot watch the folder " << options.input << "\n";
+		return 1;
+	}
 
-		if (packedRect.height <= 0) {
-			std::cout << "Error: The pack is full\n";
+	while (true) {
+		buildSheet(images, computeLayout(getImageSizes(images), getMaskImages(images, options), options, workerThreads(options)), options, pool, std::cout, nullptr);
+		if (!options.trace.empty() && !writeTrace(options.trace)) std::cout << "Error: cannot write " << options.trace << "\n";
+
+		std::cout << "watching " << options.input << "\n";
+		const std::vector<std::string> changes = watcher.wait(QUIET_MS);
+
+		// The images written are decoded again together once the deleted ones are dropped, so the reads overlap the decoding
+		std::vector<ScannedFile> written;
+		for (const auto& path : changes) {
+			std::error_code error;
+			if (std::filesystem::is_regular_file(options.input + "/" + path, error)) {
+				const uintmax_t size = std::filesystem::file_size(options.input + "/" + path, error);
+				if (isImageFile(path) && !error) written.push_back({path, size, 0});
+				continue;
+			}
+
+			// A deleted file, or a directory deleted or moved away with its images
+			const std::string prefix = path + "/";
+			for (auto it = images.begin(); it != images.end();) {
+				if (it->first == path || it->first.compare(0, prefix.size(), prefix) == 0) it = images.erase(it);
+				else ++it;
+			}
 		}
+		loadImages(options.input, written, pool, images, workerThreads(options), std::cout);
+		std::cout << changes.size() << " file(s) changed\n";
+	}
+}
 
-		sf::Sprite spr(*imgTex[i]);			// sprite to draw on the render texture
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!parseOptions(argc, argv, options)) return 1;
 
-		// If the image is rotated
-		if (static_cast<int>(imgTex[i]->getSize().x) == packedRect.height && packedRect.width != packedRect.height) {
-			rotation = 90;					// set the rotation for the xml data
+	// Let a resident build server do the work
+	if (!options.client.empty()) return runBuildClient(options);
+	if (!options.serve.empty()) return runBuildServer(options);
 
-			// Rotate the sprite to draw
-			size_t oldHeight = spr.getTextureRect().height;
-			spr.setPosition(static_cast<float>(packedRect.x), static_cast<float>(packedRect.y));
-			spr.rotate(rotation);
-			spr.setPosition(spr.getPosition().x + static_cast<float>(oldHeight), spr.getPosition().y);
-		}
-		else { // If there is no rotation
-			rotation = 0;
-			spr.setPosition(static_cast<float>(packedRect.x), static_cast<float>(packedRect.y));
-		}
+	if (!options.trace.empty()) startTrace();
 
-		rend.draw(spr);					// draw the sprite on the sprite sheet
-		// Save data of the image for the xml file
-		images.emplace_back(filename, imgTexID[i], packedRect.x, packedRect.y, packedRect.width, packedRect.height, static_cast<size_t>(rotation));
-	}
+	PixelPool  pool(static_cast<size_t>(options.pixelLimitMb) << 20);	// memory of the decoded images and of the pages
+	ImageCache images;				// decoded images
+	ImageFiles files;				// images decoded straight into the pages
 
-	rend.display();						// render the texture properly
+	// A single build only needs the size of the images before the layout, unless channel packing looks at their pixels
+	const bool direct = !options.watch && !options.channelPack;
 
-	// Free the memory of the images
-	for (auto& tex : imgTex) {
-		delete(tex);
+	// Load all the images of the input folder and its subfolders
+	std::vector<ScannedFile> scanned;
+	{
+		TraceScope trace("scan images", options.input);
+		scanned = scanImages(options.input, workerThreads(options));
+	}
+	if (direct) files = readImageSizes(options.input, scanned, workerThreads(options));
+	else if (!loadImages(options.input, scanned, pool, images, workerThreads(options), std::cout)) return 1;
+	const std::vector<rbp::RectSize> imgSizes = direct ? getImageSizes(files) : getImageSizes(images);
+
+	// Measure the allocations of the packers
+	if (options.benchmarkPacking > 0) {
+		benchmarkPacking(imgSizes, static_cast<int>(options.pageWidth), static_cast<int>(options.pageHeight), options.benchmarkPacking);
+		return 0;
 	}
 
-	// Save the sprite sheet
-	sf::Texture tex = rend.getTexture();
-	sf::Image   img = tex.copyToImage(); // need to create an image to save a file
-	img.saveToFile("sheets/" + filename + ".png");
+	// Check that the files written are the same whatever the number of threads
+	if (options.verifyDeterminism) return verifyDeterminism(images, files, direct, imgSizes, options, pool);
 
-	// Generate the xml document
-	std::string xml = getXmlSheet(images, filename + ".png");
-	std::cout << xml; // display the xml file in the console
+	// Rebuild on every change instead of showing the preview
+	if (options.watch) return watchImages(images, options, pool);
 
-	// Save the XML document
-	std::ofstream xmlFile;
-	xmlFile.open("sheets/" + filename + ".xml");
-	xmlFile << xml;
-	xmlFile.close();
+	// Choose the best heuristic, optimize the layout and write the sheet
+	sf::Texture  tex;					// first page, displayed at the end
+	const Layout layout = computeLayout(imgSizes, getMaskImages(images, options), options, workerThreads(options));
+	if (!(direct ? buildSheet(files, layout, options, pool, std::cout, &tex) : buildSheet(images, layout, options, pool, std::cout, &tex))) return 1;
+	if (!options.trace.empty() && !writeTrace(options.trace)) std::cout << "Error: cannot write " << options.trace << "\n";
 
-	// See the occupancy of the packing
-	std::cout << "pack1 : " << pack.occupancy() << "%\n";
+	// Give the memory of the images back to the pool
+	images.clear();
 
 	// SFML code the create a window and display the sprite sheet
-	sf::RenderWindow window(sf::VideoMode(size.x, size.y), "Sprite sheets generator");
+	sf::RenderWindow window(sf::VideoMode(options.pageWidth, options.pageHeight), "Sprite sheets generator");
 	sf::Sprite       spr(tex);
 
 	while (window.isOpen()) {